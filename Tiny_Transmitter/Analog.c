@@ -0,0 +1,196 @@
+/*******************************************************************************
+File:			Analog.c
+
+ 				Background telemetry sampling function library. Each channel
+				is timed with the analog comparator and Timer1 input capture,
+				one step per bit clock tick while the transmitter is off.
+				Telemetry reads the cached averages and never waits.
+
+Functions:	extern void ADCInit (void)
+				extern void ADCSuspend (void)
+				extern void ADCResume (void)
+				extern void ADCStep (void)
+				extern unsigned char ADCGet (unsigned char channel)
+
+Revisions:	1.00	10/17/26	Replaces the missing ADCGet
+
+Copyright:		(c)2014, Justin D. Owen (justin.owen2@tulsacc.edu). All rights reserved.
+				This software is available only for non-commercial amateur radio
+				or educational applications.  All other uses are prohibited.
+				This software may be modified only if the resulting code be
+				made available publicly and the original author(s) given credit.
+
+*******************************************************************************/
+
+// OS headers
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+// General purpose include files
+#include "Std_Defines.h"
+
+// App required include files
+#include "ax25.h"
+#include "Tiny_Transmitter.h"
+#include "Analog.h"
+
+#ifdef ANALOG_SAMPLING
+
+#define	ADC_TICKS (F_CPU / 8 / BAUD_RATE)	// Timer1 counts per bit period
+#define	ADC_SCALE (255UL * 65536 / ADC_TICKS)	// Full scale to 255, times 65536
+#define	ADC_DRIVES (ADC_DRIVE0 | ADC_DRIVE1)
+
+#if (ADC_OVERSAMPLE & (ADC_OVERSAMPLE - 1)) || (ADC_OVERSAMPLE > 32)
+#error "ADC_OVERSAMPLE must be a power of two no larger than 32"
+#endif
+
+// Drive pin for each channel
+static const unsigned char adc_drive[ADC_CHANNELS] PROGMEM = {
+	ADC_DRIVE0, ADC_DRIVE1};
+
+static volatile unsigned char	adc_enabled;	// Cleared while keyed up
+static unsigned char	adc_charging;		// A charge is under way
+static unsigned short	adc_start;		// TCNT1 when the charge began
+static unsigned short	adc_sum;			// Counts of this channel so far
+static unsigned char	adc_samples;		// Samples in adc_sum
+static unsigned char	adc_channel;		// Channel being sampled
+static volatile unsigned char	adc_value[ADC_CHANNELS];	// Latest averages
+
+
+/******************************************************************************/
+extern void ADCInit(void)
+/*******************************************************************************
+* ABSTRACT:	Connects the comparator to the bandgap and to the Timer1 input
+*				capture, drives every channel low and starts discharging the
+*				timing capacitor. Call after ax25init() has started Timer1.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	ACSR = (1<<ACBG) | (1<<ACIC);			// 1.1V on the + input, out to ICP
+	DIDR |= (1<<AIN1D);						// AIN1 is analog only
+	PORTB &= ~(ADC_DRIVES | ADC_NODE);
+	DDRB |= ADC_DRIVES | ADC_NODE;			// All low, capacitor shorted
+	adc_enabled = TRUE;
+	return;
+
+}		// End ADCInit(void)
+
+
+/******************************************************************************/
+extern void ADCSuspend(void)
+/*******************************************************************************
+* ABSTRACT:	Stops sampling before the transmitter keys up. The tone ISR
+*				owns PORTB from here, so any charge under way is dropped and
+*				the capacitor is held discharged.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	adc_enabled = FALSE;						// The bit ISR leaves us alone now
+	adc_charging = FALSE;
+	PORTB &= ~ADC_DRIVES;
+	DDRB |= ADC_NODE;
+	return;
+
+}		// End ADCSuspend(void)
+
+
+/******************************************************************************/
+extern void ADCResume(void)
+/*******************************************************************************
+* ABSTRACT:	Restarts sampling once the transmitter is off. Called from the
+*				AX.25 bit ISR through mainReceive().
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	adc_enabled = TRUE;
+	return;
+
+}		// End ADCResume(void)
+
+
+/******************************************************************************/
+extern void ADCStep(void)
+/*******************************************************************************
+* ABSTRACT:	Runs one step of the sampler from the bit ISR. Steps alternate:
+*				one releases the capacitor and charges it through the channel,
+*				the next reads the input capture, drops the drive and shorts
+*				the capacitor again. The capture latches in hardware, so the
+*				time is exact whatever the interrupt latency. No capture by
+*				the next tick reads as full scale. After ADC_OVERSAMPLE
+*				samples the average is scaled to 0-255 and stored.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	unsigned short	count;
+	unsigned short	capture;
+
+	if (!adc_enabled) return;
+
+	if (!adc_charging)						// Shorted for a whole bit period
+	{
+		DDRB &= ~ADC_NODE;						// Let the capacitor float...
+		PORTB |= pgm_read_byte(&adc_drive[adc_channel]);	// ...and charge
+		adc_start = TCNT1;
+		TIFR = (1<<ICF1);						// Arm for the threshold crossing
+		adc_charging = TRUE;
+		return;
+	}
+
+	if (TIFR & (1<<ICF1))					// Crossed the threshold
+	{
+		capture = ICR1;
+		count = (capture >= adc_start)? capture - adc_start :
+									capture + ADC_TICKS - adc_start;	// Timer1 wraps
+		if (count > ADC_TICKS) count = ADC_TICKS;
+	}
+	else
+	{
+		count = ADC_TICKS;					// Never crossed, full scale
+	}
+	PORTB &= ~ADC_DRIVES;
+	DDRB |= ADC_NODE;							// Discharge for the next sample
+	adc_charging = FALSE;
+
+	adc_sum += count;
+	if (++adc_samples == ADC_OVERSAMPLE)
+	{
+		count = adc_sum / ADC_OVERSAMPLE;	// Average, 0 to ADC_TICKS
+		adc_value[adc_channel] = (count * ADC_SCALE) >> 16;
+		adc_sum = 0;
+		adc_samples = 0;
+		if (++adc_channel == ADC_CHANNELS) adc_channel = 0;
+	}
+	return;
+
+}		// End ADCStep(void)
+
+
+/******************************************************************************/
+extern unsigned char ADCGet(unsigned char channel)
+/*******************************************************************************
+* ABSTRACT:	Returns the latest average for a channel. It is only a read of
+*				the cache, so telemetry formatting never waits on a
+*				conversion.
+*
+* INPUT:		channel		Telemetry channel
+* OUTPUT:	None
+* RETURN:	0 (short) to 255 (full scale), 0 for channels not wired
+*/
+{
+	return((channel < ADC_CHANNELS)? adc_value[channel] : 0);
+
+}		// End ADCGet(unsigned char channel)
+
+#endif
@@ -0,0 +1,43 @@
+/*******************************************************************************
+File:			Analog.h
+
+ 				Telemetry sampling module definitions/declarations.
+
+Version:		1.05
+
+*******************************************************************************/
+
+// Uncomment to sample the telemetry channels in the background. The ATtiny
+// has no ADC, so each channel is an RC timing: the channel's drive pin
+// charges a capacitor on AIN1 through the sensor resistance, and the
+// analog comparator (against the 1.1V bandgap) stops Timer1 input capture
+// at the threshold. The time is proportional to R*C; full scale is one
+// bit period (833us), about R*C = 3.3ms at 5V, e.g. 33k and 100nF. G3RUH
+// shortens the bit to 104us, so size C eight times smaller there.
+// AIN1 is PB1, so the PTT moves to PB0 (the DCD LED line) in this build.
+//#define	ANALOG_SAMPLING
+
+#define	ADC_CHANNELS	(2)				// Channels wired, ADCGet reads 0 above
+#define	ADC_DRIVE0		(1<<6)			// PB6 charges through channel 0
+#define	ADC_DRIVE1		(1<<7)			// PB7 charges through channel 1
+#define	ADC_NODE			(1<<1)			// PB1 (AIN1), the timing capacitor
+#define	ADC_OVERSAMPLE	(16)				// Samples averaged per reading
+
+#if defined(ANALOG_SAMPLING) && defined(AFSK_RECEIVE)
+#error "ANALOG_SAMPLING and AFSK_RECEIVE both need the analog comparator"
+#endif
+
+#ifdef ANALOG_SAMPLING
+// external function prototypes
+extern void ADCInit(void);
+extern void ADCSuspend(void);
+extern void ADCResume(void);
+extern void ADCStep(void);
+extern unsigned char ADCGet(unsigned char channel);
+#else
+#define	ADCInit()
+#define	ADCSuspend()
+#define	ADCResume()
+#define	ADCStep()
+#define	ADCGet(channel) (0)				// No sampler, telemetry reads zero
+#endif
@@ -2,11 +2,17 @@
 # Automatically-generated file. Do not edit or delete the file
 ################################################################################
 
+Analog.c
+
 ax25.c
 
-GPS_Recieve.c
+FX25.c
+
+GPS_Receive.c
 
 Message_Create.c
 
+Number.c
+
 Tiny_Transmitter.c
 
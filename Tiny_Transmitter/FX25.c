@@ -0,0 +1,218 @@
+/*******************************************************************************
+File:			FX25.c
+
+ 				FX.25 Reed-Solomon encoder function library. The AX.25 bit ISR
+				feeds it every bit of the code block as it goes on air and
+				sends the parity straight after, so no frame is ever buffered.
+
+Functions:	extern void FX25Reset (void)
+				extern void FX25Bit (unsigned char bit)
+				static void FX25Tap (void)
+				static unsigned char FX25Multiply (unsigned char a,
+												unsigned char b)
+				extern unsigned char FX25Tag (unsigned char index)
+				extern unsigned char FX25Parity (unsigned char index)
+
+Revisions:	1.00	10/17/26	Original
+
+Copyright:		(c)2014, Justin D. Owen (justin.owen2@tulsacc.edu). All rights reserved.
+				This software is available only for non-commercial amateur radio
+				or educational applications.  All other uses are prohibited.
+				This software may be modified only if the resulting code be
+				made available publicly and the original author(s) given credit.
+
+*******************************************************************************/
+
+// OS headers
+#include <avr/pgmspace.h>
+
+// General purpose include files
+#include "Std_Defines.h"
+
+// App required include files
+#include "FX25.h"
+
+#ifdef FX25
+
+#define	GF_POLY (0x1D)						// x^8 + x^4 + x^3 + x^2 + 1, less x^8
+
+// Correlation tag for the code block size, sent least significant byte first
+#if FX25_DATA == 239
+#define	FX25_TAG_VALUE 0xB74DB7DF8A532F3EULL	// Tag_01, RS(255,239)
+#elif FX25_DATA == 128
+#define	FX25_TAG_VALUE 0x26FF60A600CC8FDEULL	// Tag_02, RS(144,128)
+#elif FX25_DATA == 64
+#define	FX25_TAG_VALUE 0xC7DC0508F3D9B09EULL	// Tag_03, RS(80,64)
+#elif FX25_DATA == 32
+#define	FX25_TAG_VALUE 0x8F056EB4369660EEULL	// Tag_04, RS(48,32)
+#else
+#error "FX25_DATA must be 32, 64, 128 or 239"
+#endif
+
+#define	TagByte(n) ((unsigned char)(FX25_TAG_VALUE >> (8 * (n))))
+
+static const unsigned char fx25_tag[FX25_TAG] PROGMEM = {
+	TagByte(0), TagByte(1), TagByte(2), TagByte(3),
+	TagByte(4), TagByte(5), TagByte(6), TagByte(7)};
+
+// Generator polynomial with roots alpha^1 to alpha^16, highest power first
+// and the leading 1 left out. Entry i multiplies into parity byte i.
+static const unsigned char fx25_generator[FX25_CHECK] PROGMEM = {
+	0x76, 0x34, 0x67, 0x1F, 0x68, 0x7E, 0xBB, 0xE8,
+	0x11, 0x38, 0xB7, 0x31, 0x64, 0x51, 0x2C, 0x4F};
+
+// Static functions
+static void FX25Tap(void);
+static unsigned char FX25Multiply(unsigned char a, unsigned char b);
+
+static unsigned char	fx25_parity[FX25_CHECK];	// Encoder register
+static unsigned char	fx25_byte;			// Bits of the current byte so far
+static unsigned char	fx25_bits;			// How many
+static unsigned char	fx25_feedback;		// Divisor multiple for this byte
+static unsigned char	fx25_tap;			// Parity bytes updated so far
+
+
+/******************************************************************************/
+extern void FX25Reset(void)
+/*******************************************************************************
+* ABSTRACT:	Clears the encoder for a new code block.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	unsigned char	loop;
+
+	for (loop = 0 ; loop < FX25_CHECK ; loop++)
+	{
+		fx25_parity[loop] = 0;
+	}
+	fx25_bits = 0;
+	fx25_tap = FX25_CHECK;					// No update pending
+	return;
+
+}		// End FX25Reset(void)
+
+
+/******************************************************************************/
+extern void FX25Bit(unsigned char bit)
+/*******************************************************************************
+* ABSTRACT:	Adds one on-air bit (after stuffing, before NRZI) to the code
+*				block. Bits pack least significant first. A whole byte only
+*				sets up the division step; its sixteen multiplies are done
+*				two per bit, so the previous byte is finished by the time the
+*				next one completes and the bit ISR never runs long. The last
+*				byte's step is finished by FX25Parity().
+*
+* INPUT:		bit			Zero or not
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	fx25_byte >>= 1;
+	if (bit) fx25_byte |= 0x80;
+	if (++fx25_bits == 8)
+	{
+		fx25_bits = 0;
+		fx25_feedback = fx25_byte ^ fx25_parity[0];
+		fx25_tap = 0;
+	}
+
+	if (fx25_tap < FX25_CHECK)
+	{
+		FX25Tap();
+		FX25Tap();
+	}
+	return;
+
+}		// End FX25Bit(unsigned char bit)
+
+
+/******************************************************************************/
+static void FX25Tap(void)
+/*******************************************************************************
+* ABSTRACT:	Updates the next parity byte for the pending division step:
+*				the register shifts down one byte and takes the feedback
+*				times the generator. Going from byte 0 up, each byte still
+*				reads its old neighbour.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	unsigned char	next;
+
+	next = (fx25_tap < FX25_CHECK - 1)? fx25_parity[fx25_tap + 1] : 0;
+	fx25_parity[fx25_tap] = next ^ FX25Multiply(fx25_feedback,
+							pgm_read_byte(&fx25_generator[fx25_tap]));
+	fx25_tap++;
+	return;
+
+}		// End FX25Tap(void)
+
+
+/******************************************************************************/
+static unsigned char FX25Multiply(unsigned char a, unsigned char b)
+/*******************************************************************************
+* ABSTRACT:	Multiplies in GF(256) by shift and add. No log tables, so it
+*				costs no flash; at most eight passes.
+*
+* INPUT:		a, b			Field elements
+* OUTPUT:	None
+* RETURN:	a times b
+*/
+{
+	unsigned char	product;
+
+	product = 0;
+	while (b)
+	{
+		if (b & 1) product ^= a;
+		a = (a & 0x80)? (a << 1) ^ GF_POLY : a << 1;
+		b >>= 1;
+	}
+
+	return(product);
+
+}		// End FX25Multiply(unsigned char a, unsigned char b)
+
+
+/******************************************************************************/
+extern unsigned char FX25Tag(unsigned char index)
+/*******************************************************************************
+* ABSTRACT:	Returns one byte of the correlation tag for FX25_DATA.
+*
+* INPUT:		index		0 to FX25_TAG - 1
+* OUTPUT:	None
+* RETURN:	The tag byte
+*/
+{
+	return(pgm_read_byte(&fx25_tag[index]));
+
+}		// End FX25Tag(unsigned char index)
+
+
+/******************************************************************************/
+extern unsigned char FX25Parity(unsigned char index)
+/*******************************************************************************
+* ABSTRACT:	Returns one parity byte of the finished code block. Any of the
+*				last division step still pending for this byte is done first,
+*				one multiply per parity byte at most.
+*
+* INPUT:		index		0 to FX25_CHECK - 1, in the order sent
+* OUTPUT:	None
+* RETURN:	The parity byte
+*/
+{
+	while (fx25_tap <= index)
+	{
+		FX25Tap();
+	}
+
+	return(fx25_parity[index]);
+
+}		// End FX25Parity(unsigned char index)
+
+#endif
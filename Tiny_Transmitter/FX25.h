@@ -0,0 +1,25 @@
+/*******************************************************************************
+File:			FX25.h
+
+ 				FX.25 forward error correction module definitions/declarations.
+
+Version:		1.05
+
+*******************************************************************************/
+
+// Uncomment to wrap every frame in FX.25: a correlation tag, then the
+// frame's on-air bits as a Reed-Solomon code block, then the parity. The
+// AX.25 bits inside are unchanged, so plain receivers still decode them.
+// FX25_DATA must hold the largest frame with its flags and stuffing; a
+// frame that does not fit goes out without parity.
+//#define	FX25
+
+#define	FX25_DATA	(128)					// Code block bytes: 32, 64, 128 or 239
+#define	FX25_CHECK	(16)					// Parity bytes, RS(255,239) family
+#define	FX25_TAG		(8)					// Correlation tag bytes
+
+// external function prototypes
+extern void FX25Reset(void);
+extern void FX25Bit(unsigned char bit);
+extern unsigned char FX25Tag(unsigned char index);
+extern unsigned char FX25Parity(unsigned char index);
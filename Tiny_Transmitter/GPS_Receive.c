@@ -4,11 +4,15 @@ File:			GPS_Recieve.c
 				Serial I/O subsystem function library.
 
 Functions:	extern void		SerInit(void)
+				extern void		SerSuspend(void)
+				extern void		SerResume(void)
+				extern void		SerReport(void)
 				extern void		SendByte(unsigned char chr)
 				extern void 	SendString(char *address)
-				extern void 	Serial_Processes(void)
-				SIGNAL(SIG_UART_RECV)
-				SIGNAL(SIG_UART_TRANS)
+				extern void 	SendNumber(unsigned long value)
+				extern unsigned char Serial_Processes(void)
+				ISR(USART_RX_vect)
+				ISR(USART_UDRE_vect)
 
 Revisions:		1.00	04/14/03	GND	Original - Gary N. Dion
 				1.01	11/01/04	GND	Modified for ISR based transmit
@@ -34,15 +38,45 @@ Copyright:	(c)2005, Gary N. Dion (me@garydion.com). All rights reserved.
 // App required include files
 #include "Message_Create.h"
 #include "GPS_Receive.h"
-
-#define	BUF_SIZE		(96)					// Educated guess for a good buffer size
-
-static unsigned char inbuf[BUF_SIZE];	// USART input buffer array
-static unsigned char inhead;				// USART input buffer head pointer
-static unsigned char intail;				// USART input buffer tail pointer
-static unsigned char outbuf[BUF_SIZE];	// USART output buffer array
-static unsigned char outhead;				// USART output buffer head pointer
-static unsigned char outtail;				// USART output buffer tail pointer
+#include "Tiny_Transmitter.h"
+#include "Number.h"
+
+// Ring sizes must be powers of two no larger than 128. The head and tail
+// indices run freely and wrap at 256, so head - tail is always the number
+// of bytes waiting and one index mask finds the slot.
+#define	IN_SIZE		(64)					// 130ms of NMEA at 4800 baud
+#define	OUT_SIZE		(32)					// Reports are short
+#define	IN_MASK		(IN_SIZE - 1)
+#define	OUT_MASK		(OUT_SIZE - 1)
+
+#if !defined(NMEA_IN_ISR) && ((IN_SIZE & IN_MASK) || (IN_SIZE > 128))
+#error "IN_SIZE must be a power of two no larger than 128"
+#endif
+#if (OUT_SIZE & OUT_MASK) || (OUT_SIZE > 128)
+#error "OUT_SIZE must be a power of two no larger than 128"
+#endif
+
+// Each ring has one producer and one consumer. The producer stores the
+// byte and then advances head; the consumer reads the byte and then
+// advances tail. Everything is volatile so the compiler keeps that order.
+#ifndef NMEA_IN_ISR
+static volatile unsigned char inbuf[IN_SIZE];	// USART input ring
+static volatile unsigned char inhead;		// Written only by the RX ISR
+static volatile unsigned char intail;		// Written only by Serial_Processes
+#endif
+static volatile unsigned char outbuf[OUT_SIZE];	// USART output ring
+static volatile unsigned char outhead;		// Written only by SendByte
+static volatile unsigned char outtail;		// Written only by the UDRE ISR
+static volatile unsigned char	suspended;	// Transmitter is keyed, UART paused
+
+// Loss accounting, so a dropped GPS byte is never silent
+static volatile unsigned short	in_overflows;	// Bytes lost, ring full or overrun
+#ifndef NMEA_IN_ISR
+static volatile unsigned char	in_highwater;	// Most bytes ever waiting
+#else
+#define	in_highwater	(0)				// No ring, nothing ever waits
+#endif
+static volatile unsigned short	out_drops;		// Report bytes lost while keyed
 
 
 /******************************************************************************/
@@ -63,31 +97,115 @@ extern void		SerInit(void)
 	// Set frame format to 8 data bits, no parity, and 1stop bit
 	UCSRC = (1<<UMSEL)|(3<<UCSZ0);
 
-	// Enable Receiver and Transmitter Interrupt, Receiver and Transmitter
-	UCSRB = (1<<RXCIE)|(1<<TXCIE)|(1<<RXEN)|(1<<TXEN);
+	// Enable Receiver Interrupt, Receiver and Transmitter. The data
+	// register empty interrupt is only enabled while there is output.
+	UCSRB = (1<<RXCIE)|(1<<RXEN)|(1<<TXEN);
 	return;
 
 }		// End SerInit(void)
 
 
+/******************************************************************************/
+extern void		SerSuspend(void)
+/*******************************************************************************
+* ABSTRACT:	This function stops the serial interrupts while the transmitter
+*				is keyed, so they cannot disturb the tone timing.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	suspended = TRUE;
+	UCSRB &= ~((1<<RXCIE)|(1<<UDRIE));	// Disable the serial interrupts
+	return;
+
+}		// End SerSuspend(void)
+
+
+/******************************************************************************/
+extern void		SerResume(void)
+/*******************************************************************************
+* ABSTRACT:	This function restarts the serial interrupts after a frame.
+*				It is called from the AX.25 bit ISR. A GPS byte that arrived
+*				while suspended is counted as lost.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	if (UCSRA & ((1<<RXC)|(1<<DOR))) ++in_overflows;
+	suspended = FALSE;
+	UCSRB |= (1<<RXCIE);						// Receive straight away
+	if (outhead != outtail)
+	{
+		UCSRB |= (1<<UDRIE);					// And finish any pending output
+	}
+	return;
+
+}		// End SerResume(void)
+
+
+/******************************************************************************/
+extern void		SerReport(void)
+/*******************************************************************************
+* ABSTRACT:	This function writes the serial accounting to the serial port
+*				as "$PTSER,GPS bytes lost,receive high water,output bytes lost".
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	unsigned short	lost;
+	unsigned short	dropped;
+
+	cli();
+	lost = in_overflows;
+	dropped = out_drops;
+	sei();
+
+	SendString("$PTSER,");
+	SendNumber(lost);
+	SendByte(',');
+	SendNumber(in_highwater);
+	SendByte(',');
+	SendNumber(dropped);
+	SendString("\r\n");
+	return;
+
+}		// End SerReport(void)
+
+
 /******************************************************************************/
 extern void		SendByte(unsigned char chr)
 /*******************************************************************************
-* ABSTRACT:	This function pushes a new character into the output buffer
-*				then pre-advances the pointer to the next empty location.
+* ABSTRACT:	This function pushes a new character into the output ring and
+*				lets the data register empty interrupt send it. Only the ISR
+*				touches UDR. When the ring is full it waits for room, unless
+*				the UART is suspended for a transmission; then the byte is
+*				dropped and counted.
 *
 * INPUT:		chr			byte to send
 * OUTPUT:	None
 * RETURN:	None
 */
 {
-	if (++outhead == BUF_SIZE) outhead = 0;	// Advance and wrap pointer
-	outbuf[outhead] = chr;		 			// Transfer the byte to output buffer
+	while ((unsigned char)(outhead - outtail) == OUT_SIZE)
+	{
+		if (suspended)
+		{
+			++out_drops;
+			return;
+		}
+	}
 
-	if (UCSRA & (1<<UDRE))					// If the transmit buffer is empty
+	outbuf[outhead & OUT_MASK] = chr;	// Store the byte first...
+	++outhead;								// ...then publish it to the ISR
+	if (!suspended)
 	{
-		if (++outtail == BUF_SIZE) outtail = 0;// Advance and wrap pointer
-		UDR = outbuf[outtail];				// Place the byte in the output buffer
+		UCSRB |= (1<<UDRIE);				// Wake the sender
 	}
 
 	return;
@@ -116,62 +234,127 @@ extern void SendString(char *address)
 
 
 /******************************************************************************/
-extern void 	Serial_Processes(void)
+extern void SendNumber(unsigned long value)
 /*******************************************************************************
-* ABSTRACT:	Called by main.c during idle time. Processes any waiting serial
-*				characters coming in or going out both serial ports.
+* ABSTRACT:	This function sends an unsigned number to the serial port in
+*				decimal, without leading zeros.
 *
-* INPUT:		None
+* INPUT:		value		Number to send
 * OUTPUT:	None
 * RETURN:	None
 */
 {
-	if (intail != inhead)					// If there are incoming bytes pending
+	NumFormat(num_buffer, value, 0);
+	SendString(num_buffer);
+	return;
+
+}		// End SendNumber(unsigned long value)
+
+
+/******************************************************************************/
+extern unsigned char Serial_Processes(void)
+/*******************************************************************************
+* ABSTRACT:	Called by main.c during idle time. Hands every waiting GPS
+*				character to the parser in one pass, freeing each slot as
+*				soon as it has been read.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	TRUE if any bytes were handled, FALSE if there was nothing to do
+*/
+{
+#ifdef NMEA_IN_ISR
+	return(FALSE);								// The RX ISR already parsed them
+#else
+	unsigned char	head;				// Snapshot of the ISR's head
+	unsigned char	tail;				// Local copy, published per byte
+
+	head = inhead;
+	tail = intail;
+	if (tail == head) return(FALSE);		// Nothing pending
+
+	while (tail != head)
 	{
-		if (++intail == BUF_SIZE) intail = 0;	// Advance and wrap pointer
-		MsgHandler(inbuf[intail]);		// And pass it to a handler
+		MsgHandler(inbuf[tail & IN_MASK]);	// Parse the byte...
+		intail = ++tail;					// ...then give the slot back
 	}
 
-	return;
+	return(TRUE);
+#endif
 
 }		// End Serial_Processes(void)
 
 
 /******************************************************************************/
-SIGNAL(SIG_UART_RECV)
+ISR(USART_RX_vect)
 /*******************************************************************************
 * ABSTRACT:	Called by the receive ISR (interrupt). Saves the next serial
-*				byte to the head of the RX buffer.
+*				byte to the head of the RX ring, or with NMEA_IN_ISR hands it
+*				straight to the parser. A full ring or a hardware overrun is
+*				counted in in_overflows.
 *
 * INPUT:		None
 * OUTPUT:	None
 * RETURN:	None
 */
 {
-	if (++inhead == BUF_SIZE) inhead = 0;	// Advance and wrap buffer pointer
-	inbuf[inhead] = UDR;	  					// Transfer the byte to the input buffer
+	unsigned char	status;
+	unsigned char	data;
+#ifndef NMEA_IN_ISR
+	unsigned char	count;			// Bytes waiting, this one included
+#endif
+
+	ProfileEnter(PROFILE_UART_RX);
+	status = UCSRA;							// Read status before data
+	data = UDR;
+	if (status & (1<<DOR)) ++in_overflows;	// The UART lost one before this
+
+#ifdef NMEA_IN_ISR
+	MsgHandler(data);							// Straight into the fix record
+#else
+	count = inhead - intail + 1;
+	if (count > IN_SIZE)
+	{
+		++in_overflows;						// Ring full, drop the new byte
+	}
+	else
+	{
+		inbuf[inhead & IN_MASK] = data;	// Store the byte first...
+		++inhead;							// ...then publish it to main
+		if (count > in_highwater) in_highwater = count;
+	}
+#endif
+
+	ProfileExit();
 	return;
 
-}		// End SIGNAL(SIG_UART_RECV)
+}		// End ISR(USART_RX_vect)
 
 
 /******************************************************************************/
-SIGNAL(SIG_UART_TRANS)
+ISR(USART_UDRE_vect)
 /*******************************************************************************
-* ABSTRACT:	Called by the transmit ISR (interrupt). Puts the next serial
-*				byte into the TX register.
+* ABSTRACT:	Called by the data register empty ISR (interrupt). Puts the next
+*				serial byte into the TX register, and switches itself off once
+*				the output ring is empty.
 *
 * INPUT:		None
 * OUTPUT:	None
 * RETURN:	None
 */
 {
+	ProfileEnter(PROFILE_UART_TX);
 	if (outtail != outhead)					// If there are outgoing bytes pending
 	{
-		if (++outtail == BUF_SIZE) outtail = 0;// Advance and wrap pointer
-		UDR = outbuf[outtail];				// Place the byte in the output buffer
+		UDR = outbuf[outtail & OUT_MASK];	// Send the byte first...
+		++outtail;							// ...then free the slot
+	}
+	else
+	{
+		UCSRB &= ~(1<<UDRIE);				// Nothing left, stop interrupting
 	}
 
+	ProfileExit();
 	return;
 
-}		// End SIGNAL(SIG_UART_TRANS)
+}		// End ISR(USART_UDRE_vect)
@@ -7,8 +7,24 @@ Version:		1.05
 
 *******************************************************************************/
 
+// Uncomment to run the NMEA parser inside the UART receive interrupt. The
+// 64 byte input ring goes away and fix fields are written as they arrive,
+// with no main loop polling. The worst byte should be a comma, which scans
+// the whole nmea_fields table; the GPS_UBX parser never scans a table. The
+// bound is 30720 cycles, one character at 4800 baud. make budgets
+// OPTIONS="-DNMEA_IN_ISR" in Target measures it under simavr from the
+// PROFILE_UART_RX marker, and prints the worst with the sentence that
+// caused it; make cycles then holds every build to that figure. The UART
+// is suspended while keyed, so the parser never delays the tone or bit
+// interrupts.
+//#define	NMEA_IN_ISR
+
 // external function prototypes
 extern void		SerInit(void);
+extern void		SerSuspend(void);
+extern void		SerResume(void);
+extern void		SerReport(void);
 extern void		SendByte(unsigned char chr);
 extern void 	SendString(char *address);
-extern void 	Serial_Processes (void);
+extern void 	SendNumber(unsigned long value);
+extern unsigned char Serial_Processes (void);
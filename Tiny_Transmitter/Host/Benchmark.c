@@ -0,0 +1,430 @@
+/*******************************************************************************
+File:			Benchmark.c
+
+				Host micro-benchmarks for the protocol and parsing modules.
+				Each runs for about BENCH_SECONDS of wall time and prints its
+				rate, so a change can be measured before it is flashed. The
+				figures are for the workstation, not the ATtiny: compare them
+				between builds, not against the 14.7456 MHz budgets. The NMEA
+				benchmark replays a log file if one is named, such as
+				Sample.nmea.
+
+Functions:	extern int main(int argc, char **argv)
+				static void BenchReport(const char *name, double count,
+									const char *unit, double seconds)
+				static void BenchLoad(const char *path)
+				static void BenchFcs(void)
+				static void BenchNmea(void)
+				static void BenchFrames(void)
+				static unsigned char BenchSubtract(char *buffer,
+												unsigned long value)
+				static void BenchFormat(void)
+
+*******************************************************************************/
+
+// OS headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// General purpose include files
+#include "Std_Defines.h"
+
+// App required include files
+#include "ax25.h"
+#include "Message_Create.h"
+#include "Number.h"
+#include "Host.h"
+
+#define	BENCH_SECONDS (0.5)					// Wall time per benchmark
+
+// One second of a typical receiver's output: the fix pair the parser keeps
+// plus the sentences it has to skip
+static const char bench_nmea[] =
+	"$GPRMC,183512.00,A,3607.40741,N,09559.25932,W,12.345,87.65,171026,,,A*75\r\n"
+	"$GPVTG,87.65,T,,M,12.345,N,22.863,K,A*0D\r\n"
+	"$GPGGA,183512.00,3607.40741,N,09559.25932,W,1,09,0.95,1234.5,M,-26.1,M,,*55\r\n"
+	"$GPGSA,A,3,05,07,13,15,18,20,24,28,30,,,,1.73,0.95,1.45*0B\r\n"
+	"$GPGSV,3,1,11,05,41,064,38,07,22,316,30,13,69,003,42,15,37,185,40*72\r\n"
+	"$GPGSV,3,2,11,18,14,040,29,20,09,117,25,24,31,271,35,28,11,323,27*7B\r\n"
+	"$GPGSV,3,3,11,30,56,210,44,36,37,147,,49,40,185,*4C\r\n"
+	"$GPGLL,3607.40741,N,09559.25932,W,183512.00,A,A*7C\r\n";
+
+// The NMEA the parser is timed on: bench_nmea, or a log from BenchLoad
+static const char	*bench_log = bench_nmea;
+static size_t	bench_log_size = sizeof(bench_nmea) - 1;
+
+static volatile unsigned long	bench_sink;	// Keeps results from being optimized out
+
+
+/******************************************************************************/
+static void BenchReport(const char *name, double count, const char *unit,
+												double seconds)
+/*******************************************************************************
+* ABSTRACT:	Prints one result line: the rate, and the time per item.
+*
+* INPUT:		name		Benchmark name
+*				count		Items processed
+*				unit		What an item is
+*				seconds	Time taken
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	char	rate[16];
+
+	snprintf(rate, sizeof(rate), "%s/s", unit);
+	printf("%-10s %12.0f %-11s %10.1f ns/%s\n", name, count / seconds, rate,
+												seconds * 1e9 / count, unit);
+	return;
+
+}		// End BenchReport(const char *name, double count, ...)
+
+
+/******************************************************************************/
+static void BenchLoad(const char *path)
+/*******************************************************************************
+* ABSTRACT:	Reads an NMEA log for the parser benchmark. Exits if it can't.
+*
+* INPUT:		path		Log file name
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	FILE	*file;
+	char	*log;
+	long	size;
+
+	file = fopen(path, "rb");
+	if (!file)
+	{
+		perror(path);
+		exit(1);
+	}
+	fseek(file, 0, SEEK_END);
+	size = ftell(file);
+	rewind(file);
+	log = malloc(size + 1);
+	if (!log || (fread(log, 1, size, file) != (size_t)size))
+	{
+		perror(path);
+		exit(1);
+	}
+	fclose(file);
+
+	bench_log = log;
+	bench_log_size = size;
+	return;
+
+}		// End BenchLoad(const char *path)
+
+
+/******************************************************************************/
+static void BenchFcs(void)
+/*******************************************************************************
+* ABSTRACT:	FCS throughput: ax25crcBuffer over 255 byte blocks, then the
+*				bitwise reference it replaced, and the time the table saves
+*				on a 100 byte frame.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	unsigned char	block[255];
+	unsigned short	crc = CRC_INIT;
+	double	start, elapsed;
+	double	bytes = 0;
+	double	table, bits;				// ns per byte
+	unsigned short	loop, index;
+
+	for (loop = 0 ; loop < sizeof(block) ; loop++)
+	{
+		block[loop] = (unsigned char)(loop * 37 + 11);
+	}
+
+	start = HostSeconds();
+	do
+	{
+		for (loop = 0 ; loop < 1000 ; loop++)
+		{
+			crc = ax25crcBuffer(crc, block, sizeof(block));
+		}
+		bytes += 1000.0 * sizeof(block);
+		elapsed = HostSeconds() - start;
+	} while (elapsed < BENCH_SECONDS);
+	BenchReport("fcs", bytes, "byte", elapsed);
+	table = elapsed * 1e9 / bytes;
+
+	bytes = 0;
+	start = HostSeconds();
+	do
+	{
+		for (loop = 0 ; loop < 1000 ; loop++)
+		{
+			for (index = 0 ; index < sizeof(block) ; index++)
+			{
+				crc = HostCrcBits(crc, block[index]);
+			}
+		}
+		bytes += 1000.0 * sizeof(block);
+		elapsed = HostSeconds() - start;
+	} while (elapsed < BENCH_SECONDS);
+	BenchReport("fcs-bits", bytes, "byte", elapsed);
+	bits = elapsed * 1e9 / bytes;
+
+	printf("%-10s %12.0f ns saved per 100 byte frame, %.1fx\n", "fcs",
+												(bits - table) * 100, bits / table);
+	bench_sink = crc;
+	return;
+
+}		// End BenchFcs(void)
+
+
+/******************************************************************************/
+static void BenchNmea(void)
+/*******************************************************************************
+* ABSTRACT:	NMEA parser throughput: the log fed to MsgHandler a byte at a
+*				time, as Serial_Processes does, in bytes and sentences.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	double	start, elapsed;
+	double	passes = 0;
+	unsigned long	sentences = 0;
+	size_t	index;
+
+	for (index = 0 ; index < bench_log_size ; index++)
+	{
+		if (bench_log[index] == '$') ++sentences;
+	}
+
+	start = HostSeconds();
+	do
+	{
+		for (index = 0 ; index < bench_log_size ; index++)
+		{
+			MsgHandler(bench_log[index]);
+		}
+		++passes;
+		elapsed = HostSeconds() - start;
+	} while (elapsed < BENCH_SECONDS);
+
+	BenchReport("nmea", passes * bench_log_size, "byte", elapsed);
+	BenchReport("nmea", passes * sentences, "sentence", elapsed);
+	return;
+
+}		// End BenchNmea(void)
+
+
+/******************************************************************************/
+static void BenchFrames(void)
+/*******************************************************************************
+* ABSTRACT:	Frame encoding: the beacon key-up main() sends, position and
+*				telemetry frames, built and played out through the bit ISR
+*				with its TXDELAY and TXTAIL flags.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	double	start, elapsed;
+	unsigned long	keyups = host_keyups;
+	double	frames = 0;
+	const char	*next;
+
+	for (next = bench_nmea ; *next ; next++)	// A fix to send
+	{
+		MsgHandler(*next);
+	}
+
+	start = HostSeconds();
+	do
+	{
+		MsgPrepare();
+		ax25sendHeader();
+		MsgSendPos();
+		ax25sendFooter();
+		ax25sendHeader();
+		MsgSendTelem();
+		ax25sendFooter();
+		MsgRelease();
+		ax25sendEnd();
+		ax25sendWait();
+		frames += 2;
+		elapsed = HostSeconds() - start;
+	} while (elapsed < BENCH_SECONDS);
+
+	if (host_keyups - keyups != frames / 2)
+	{
+		printf("frames     key-ups lost: %lu of %.0f\n",
+							(unsigned long)(frames / 2) - (host_keyups - keyups), frames / 2);
+	}
+	BenchReport("frames", frames, "frame", elapsed);
+	return;
+
+}		// End BenchFrames(void)
+
+
+/******************************************************************************/
+static unsigned char BenchSubtract(char *buffer, unsigned long value)
+/*******************************************************************************
+* ABSTRACT:	Decimal by repeated subtraction of each power of ten, as the
+*				formatters did before NumFormat. Timed as its reference.
+*
+* INPUT:		*buffer		Room for NUM_DIGITS + 1 bytes
+*				value			Number to convert
+* OUTPUT:	*buffer		The digits
+* RETURN:	The number of digits written
+*/
+{
+	static const unsigned long	powers[NUM_DIGITS] = {
+		1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL,
+		10000UL, 1000UL, 100UL, 10UL, 1UL};
+	unsigned char	count = 0;
+	unsigned char	index;
+	char	digit;
+
+	for (index = 0 ; index < NUM_DIGITS ; index++)
+	{
+		for (digit = '0' ; value >= powers[index] ; digit++)
+		{
+			value -= powers[index];
+		}
+		if (count || (digit != '0') || (index == NUM_DIGITS - 1))
+		{
+			buffer[count++] = digit;			// No leading zeros
+		}
+	}
+	buffer[count] = 0;
+
+	return(count);
+
+}		// End BenchSubtract(char *buffer, unsigned long value)
+
+
+/******************************************************************************/
+static void BenchFormat(void)
+/*******************************************************************************
+* ABSTRACT:	Formatting cost: NumFormat across the unsigned long range and
+*				the repeated subtraction it replaced, NumParse of a typical
+*				NMEA field, and the meters to feet conversion behind the
+*				altitude field.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	static const char	*fields[4] = {"3607.40741", "1234.5", "087.65", "12.345"};
+	double	start, elapsed;
+	double	calls;
+	unsigned long	value = 1;
+	unsigned long	sum = 0;
+	unsigned short	loop;
+	unsigned char	which;
+
+	for (which = 0 ; which < 2 ; which++)
+	{
+		calls = 0;
+		start = HostSeconds();
+		do
+		{
+			for (loop = 0 ; loop < 10000 ; loop++)
+			{
+				value = (value * 1103515245UL + 12345) & 0xFFFFFFFFUL;
+				sum += which? BenchSubtract(num_buffer, value >> (loop & 31))
+								: NumFormat(num_buffer, value >> (loop & 31), 0);
+			}
+			calls += 10000;
+			elapsed = HostSeconds() - start;
+		} while (elapsed < BENCH_SECONDS);
+		BenchReport(which? "format-sub" : "format", calls, "call", elapsed);
+	}
+
+	calls = 0;
+	start = HostSeconds();
+	do
+	{
+		for (loop = 0 ; loop < 10000 ; loop++)
+		{
+			sum += NumParse((unsigned char *)fields[loop & 3], 2);
+		}
+		calls += 10000;
+		elapsed = HostSeconds() - start;
+	} while (elapsed < BENCH_SECONDS);
+	BenchReport("parse", calls, "call", elapsed);
+
+	calls = 0;
+	start = HostSeconds();
+	do
+	{
+		for (loop = 0 ; loop < 10000 ; loop++)
+		{
+			value = (value * 1103515245UL + 12345) & 0xFFFFFFFFUL;
+			sum += NumMetersToFeet(value & 0x7FFFF);
+		}
+		calls += 10000;
+		elapsed = HostSeconds() - start;
+	} while (elapsed < BENCH_SECONDS);
+	BenchReport("feet", calls, "call", elapsed);
+
+	bench_sink = sum;
+	return;
+
+}		// End BenchFormat(void)
+
+
+/******************************************************************************/
+extern int main(int argc, char **argv)
+/*******************************************************************************
+* ABSTRACT:	Runs every benchmark, or only those named on the command line.
+*				Any other argument is an NMEA log to replay.
+*
+* INPUT:		argv		Benchmark names: fcs, nmea, frames, format
+* OUTPUT:	None
+* RETURN:	0
+*/
+{
+	static const struct
+	{
+		const char	*name;
+		void			(*run)(void);
+	} benches[] = {
+		{"fcs", BenchFcs},
+		{"nmea", BenchNmea},
+		{"frames", BenchFrames},
+		{"format", BenchFormat}};
+	unsigned char	run[sizeof(benches) / sizeof(benches[0])];
+	unsigned char	named = FALSE;			// Some benchmarks were named
+	unsigned char	loop;
+	int	arg;
+
+	memset(run, FALSE, sizeof(run));
+	for (arg = 1 ; arg < argc ; arg++)
+	{
+		for (loop = 0 ; (loop < sizeof(run)) && strcmp(argv[arg], benches[loop].name) ; loop++);
+		if (loop < sizeof(run))
+		{
+			run[loop] = named = TRUE;
+		}
+		else
+		{
+			BenchLoad(argv[arg]);
+		}
+	}
+
+	HostInit();
+
+	for (loop = 0 ; loop < sizeof(run) ; loop++)
+	{
+		if (run[loop] || !named) benches[loop].run();
+	}
+
+	return(0);
+
+}		// End main(int argc, char **argv)
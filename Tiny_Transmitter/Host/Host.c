@@ -0,0 +1,230 @@
+/*******************************************************************************
+File:			Host.c
+
+				Host build support. Stands in for the register file, the
+				EEPROM and the parts of Tiny_Transmitter.c the protocol
+				modules call, so they run natively on a workstation.
+
+Functions:	extern void HostInit(void)
+				extern double HostSeconds(void)
+				extern unsigned short HostCrcBits(unsigned short crc,
+												unsigned char inbyte)
+				extern void mainReceive(void)
+				extern void mainIdle(void)
+				extern uint8_t eeprom_read_byte(const uint8_t *address)
+				extern uint16_t eeprom_read_word(const uint16_t *address)
+				extern void eeprom_read_block(void *buffer,
+									const void *address, size_t length)
+
+*******************************************************************************/
+
+// OS headers
+#include <avr/eeprom.h>
+#include <avr/io.h>
+#include <string.h>
+#include <time.h>
+
+// General purpose include files
+#include "Std_Defines.h"
+
+// App required include files
+#include "ax25.h"
+#include "Analog.h"
+#include "GPS_Receive.h"
+#include "Message_Create.h"
+#include "Tiny_Transmitter.h"
+#include "Host.h"
+
+// The register file
+volatile uint8_t	PORTB, DDRB, PINB, PORTD, DDRD, PIND;
+volatile uint8_t	TCCR0A, TCCR0B, TCNT0, OCR0A, OCR0B;
+volatile uint8_t	TCCR1A, TCCR1B, TCCR1C, TIMSK, TIFR;
+volatile uint8_t	UBRRH, UBRRL, UCSRA, UCSRB, UCSRC, UDR;
+volatile uint8_t	ACSR, DIDR, WDTCR, MCUCR, GPIOR0, GPIOR1, GPIOR2;
+volatile uint16_t	TCNT1, OCR1A, OCR1B, ICR1;
+
+unsigned char	host_eeprom[E2END + 1];
+unsigned long	host_keyups;
+void	(*host_bit_watch)(void);
+
+// The strings the EEPROM is programmed with, at ax25.c's HEADER_ADDR and
+// STATUS_ADDR: APAVR0 <- N4TXI-11, UI frame, no layer 3, and the status text
+#define	HOST_HEADER_ADDR (31)
+#define	HOST_STATUS_ADDR (48)
+static const unsigned char	host_header[] = {
+	0x82, 0xA0, 0x82, 0xAC, 0xA4, 0x60, 0x60,		// APAVR0-0
+	0x9C, 0x68, 0xA8, 0xB0, 0x92, 0x40, 0x77,		// N4TXI-11, last address
+	0x03, 0xF0, 0x00};									// Control, PID, end
+static const char	host_status[] = ">See garydion.com";
+
+// What Tiny_Transmitter.c defines for the other modules
+volatile unsigned char	asleep;
+volatile char	busy;
+
+
+/******************************************************************************/
+extern void HostInit(void)
+/*******************************************************************************
+* ABSTRACT:	Erases the EEPROM, programs the header and status text, and
+*				runs the module start-up main() runs. Every other setting
+*				reads as unprogrammed, so the firmware defaults apply.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	memset(host_eeprom, 0xFF, sizeof(host_eeprom));
+	memcpy(&host_eeprom[HOST_HEADER_ADDR], host_header, sizeof(host_header));
+	memcpy(&host_eeprom[HOST_STATUS_ADDR], host_status, sizeof(host_status));
+	SerInit();
+	MsgInit();
+	ax25init();
+	ADCInit();
+	return;
+
+}		// End HostInit(void)
+
+
+/******************************************************************************/
+extern double HostSeconds(void)
+/*******************************************************************************
+* ABSTRACT:	Reads the monotonic clock, for timing benchmarks.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	Seconds from an arbitrary start
+*/
+{
+	struct timespec	now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return(now.tv_sec + now.tv_nsec * 1e-9);
+
+}		// End HostSeconds(void)
+
+
+/******************************************************************************/
+extern unsigned short HostCrcBits(unsigned short crc, unsigned char inbyte)
+/*******************************************************************************
+* ABSTRACT:	The FCS a bit at a time, as ax25crcBit() did before the lookup
+*				table: the reference ax25crcByte() is checked and timed against.
+*
+* INPUT:		crc		The running crc register
+*				inbyte	The byte to add to the checksum
+* OUTPUT:	None
+* RETURN:	The updated crc register
+*/
+{
+	unsigned char	loop;
+
+	for (loop = 0 ; loop < 8 ; loop++)
+	{
+		if ((crc ^ (inbyte >> loop)) & 0x0001)	// XOR lsb of CRC with the bit
+		{
+			crc = (crc >> 1) ^ 0x8408;
+		}
+		else
+		{
+			crc >>= 1;
+		}
+	}
+
+	return(crc);
+
+}		// End HostCrcBits(unsigned short crc, unsigned char inbyte)
+
+
+/******************************************************************************/
+extern void mainReceive(void)
+/*******************************************************************************
+* ABSTRACT:	Called by the bit ISR when the last tail flag is out. Counts
+*				the key-up; there is no transmitter to drop.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	++host_keyups;
+	return;
+
+}		// End mainReceive(void)
+
+
+/******************************************************************************/
+extern void mainIdle(void)
+/*******************************************************************************
+* ABSTRACT:	On the chip, sleeps until the next interrupt. Every wait in the
+*				firmware is for the bit ISR to drain the queue, so here it
+*				fires the bit ISR once instead. A frame then plays out on one
+*				thread, in step with the code that queues it. A test can
+*				watch each bit go out through host_bit_watch.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	asleep = TRUE;
+	TIMER1_COMPA_vect();
+	asleep = FALSE;
+	if (host_bit_watch) host_bit_watch();
+	return;
+
+}		// End mainIdle(void)
+
+
+/******************************************************************************/
+extern uint8_t eeprom_read_byte(const uint8_t *address)
+/*******************************************************************************
+* ABSTRACT:	Reads one EEPROM byte.
+*
+* INPUT:		address	EEPROM address
+* OUTPUT:	None
+* RETURN:	The byte
+*/
+{
+	return(host_eeprom[(size_t)address & E2END]);
+
+}		// End eeprom_read_byte(const uint8_t *address)
+
+
+/******************************************************************************/
+extern uint16_t eeprom_read_word(const uint16_t *address)
+/*******************************************************************************
+* ABSTRACT:	Reads one little endian EEPROM word.
+*
+* INPUT:		address	EEPROM address
+* OUTPUT:	None
+* RETURN:	The word
+*/
+{
+	size_t	at = (size_t)address;
+
+	return(host_eeprom[at & E2END] | (host_eeprom[(at + 1) & E2END] << 8));
+
+}		// End eeprom_read_word(const uint16_t *address)
+
+
+/******************************************************************************/
+extern void eeprom_read_block(void *buffer, const void *address, size_t length)
+/*******************************************************************************
+* ABSTRACT:	Reads a block of EEPROM bytes.
+*
+* INPUT:		address	EEPROM address of the first byte
+*				length	Number of bytes
+* OUTPUT:	*buffer	The bytes
+* RETURN:	None
+*/
+{
+	size_t	at = (size_t)address;
+
+	while (length--)
+	{
+		*(uint8_t *)buffer = host_eeprom[at++ & E2END];
+		buffer = (uint8_t *)buffer + 1;
+	}
+	return;
+
+}		// End eeprom_read_block(void *buffer, const void *address, ...)
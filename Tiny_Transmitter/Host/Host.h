@@ -0,0 +1,30 @@
+/*******************************************************************************
+File:			Host.h
+
+				Host build support: the EEPROM image, the services main()
+				normally provides, and the interrupt vectors as functions.
+
+Version:		1.05
+
+*******************************************************************************/
+
+#include <avr/io.h>
+
+// The ATtiny4313 EEPROM, indexed by the firmware's fixed addresses.
+// HostInit() erases it to 0xFF, so every setting reads its default.
+extern unsigned char	host_eeprom[E2END + 1];
+
+// Key-ups completed: mainReceive() runs once per ax25sendEnd()
+extern unsigned long	host_keyups;
+
+// If set, mainIdle() calls it after each bit ISR, to watch txtone
+extern void	(*host_bit_watch)(void);
+
+// Interrupt vectors, see avr/interrupt.h
+extern void TIMER1_COMPA_vect(void);
+extern void USART_RX_vect(void);
+
+// external function prototypes
+extern void	HostInit(void);
+extern double	HostSeconds(void);
+extern unsigned short	HostCrcBits(unsigned short crc, unsigned char inbyte);
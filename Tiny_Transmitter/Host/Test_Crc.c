@@ -0,0 +1,136 @@
+/*******************************************************************************
+File:			Test_Crc.c
+
+				Checks the table-driven FCS against the bitwise reference for
+				every crc register value and every byte, and checks buffers,
+				incremental updates and the X.25 check value. Run it once
+				per CRC_TABLE_SIZE; make test does.
+
+Functions:	extern int main(void)
+				static unsigned short TestCrcBits(unsigned short crc,
+												unsigned char inbyte)
+
+*******************************************************************************/
+
+// OS headers
+#include <stdio.h>
+#include <stdlib.h>
+
+// General purpose include files
+#include "Std_Defines.h"
+
+// App required include files
+#include "ax25.h"
+
+#define	TEST_RESIDUE (0xF0B8)				// FCS register after a good frame and its FCS
+
+static unsigned long	failures;
+
+
+/******************************************************************************/
+static unsigned short TestCrcBits(unsigned short crc, unsigned char inbyte)
+/*******************************************************************************
+* ABSTRACT:	The FCS a bit at a time, as ax25crcBit() did before the lookup
+*				table: the reference ax25crcByte() is checked against.
+*
+* INPUT:		crc		The running crc register
+*				inbyte	The byte to add to the checksum
+* OUTPUT:	None
+* RETURN:	The updated crc register
+*/
+{
+	unsigned char	loop;
+
+	for (loop = 0 ; loop < 8 ; loop++)
+	{
+		if ((crc ^ (inbyte >> loop)) & 0x0001)	// XOR lsb of CRC with the bit
+		{
+			crc = (crc >> 1) ^ 0x8408;
+		}
+		else
+		{
+			crc >>= 1;
+		}
+	}
+
+	return(crc);
+
+}		// End TestCrcBits(unsigned short crc, unsigned char inbyte)
+
+
+/******************************************************************************/
+extern int main(void)
+/*******************************************************************************
+* ABSTRACT:	Runs the checks, printing the first few mismatches of each.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	0 if every check passed, 1 otherwise
+*/
+{
+	static const unsigned char	check[] = "123456789";
+	unsigned char	buffer[255];
+	unsigned long	value;
+	unsigned short	crc, expect;
+	unsigned short	length, split, loop;
+
+	// Every register value against every byte
+	for (value = 0 ; value < 0x1000000UL ; value++)
+	{
+		crc = ax25crcByte(value >> 8, value & 0xFF);
+		expect = TestCrcBits(value >> 8, value & 0xFF);
+		if ((crc != expect) && (++failures <= 5))
+		{
+			printf("ax25crcByte(%04lX, %02lX) = %04X, expected %04X\n",
+									value >> 8, value & 0xFF, crc, expect);
+		}
+	}
+
+	// Whole buffers, and the same buffers in two pieces
+	srand(1);
+	for (loop = 0 ; loop < sizeof(buffer) ; loop++)
+	{
+		buffer[loop] = rand();
+	}
+	for (length = 0 ; length <= sizeof(buffer) ; length++)
+	{
+		expect = CRC_INIT;
+		for (loop = 0 ; loop < length ; loop++)
+		{
+			expect = TestCrcBits(expect, buffer[loop]);
+		}
+		crc = ax25crcBuffer(CRC_INIT, buffer, length);
+		if ((crc != expect) && (++failures <= 10))
+		{
+			printf("ax25crcBuffer length %u = %04X, expected %04X\n",
+												length, crc, expect);
+		}
+		split = rand() % (length + 1);
+		crc = ax25crcBuffer(ax25crcBuffer(CRC_INIT, buffer, split),
+											buffer + split, length - split);
+		if ((crc != expect) && (++failures <= 15))
+		{
+			printf("ax25crcBuffer length %u split at %u = %04X, expected %04X\n",
+												length, split, crc, expect);
+		}
+	}
+
+	// The X.25 check value, and the residue once the FCS is appended
+	crc = ax25crcBuffer(CRC_INIT, (unsigned char *)check, 9);
+	if ((crc ^ 0xFFFF) != 0x906E)
+	{
+		++failures;
+		printf("FCS of \"123456789\" = %04X, expected 906E\n", crc ^ 0xFFFF);
+	}
+	crc = ax25crcByte(ax25crcByte(crc, crc ^ 0xFF), (crc >> 8) ^ 0xFF);
+	if (crc != TEST_RESIDUE)						// Low byte first, as ax25sendFooter
+	{
+		++failures;
+		printf("Residue after the FCS = %04X, expected %04X\n", crc, TEST_RESIDUE);
+	}
+
+	printf("Test_Crc, %u entry table: %s\n", CRC_TABLE_SIZE,
+												failures? "FAILED" : "passed");
+	return(failures? 1 : 0);
+
+}		// End main(void)
@@ -0,0 +1,633 @@
+/*******************************************************************************
+File:			Test_Fx25.c
+
+				Receives what the bit ISR sends with FX25 built in, the way an
+				FX.25 receiver would, and checks it. Every frame must reach a
+				plain AX.25 decoder intact, after the tag for FX25_DATA. A
+				frame whose flags and bits fit FX25_DATA bytes, down to the
+				exact fit, must be padded out with flags and carry parity
+				that makes a valid Reed-Solomon code word; the test then
+				corrupts up to FX25_CHECK / 2 bytes of it and corrects them.
+				A frame that does not fit just runs on past the block, as
+				the tag goes out before its length is known. Built without
+				FX25 it only says so; make test builds it again with FX25.
+
+Functions:	extern int main(void)
+				static void TestSend(unsigned long keyup, unsigned char count)
+				static void TestBit(void)
+				static void TestKeyup(unsigned long keyup, unsigned char count)
+				static unsigned short TestDeframe(unsigned short *at,
+												unsigned short *start)
+				static unsigned char TestTagged(unsigned short at)
+				static void TestBlock(unsigned short start, unsigned short end)
+				static unsigned char TestCorrect(unsigned char *block,
+												unsigned short length)
+				static void TestField(void)
+				static unsigned char TestMultiply(unsigned char a, unsigned char b)
+				static unsigned char TestDivide(unsigned char a, unsigned char b)
+
+*******************************************************************************/
+
+// OS headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// General purpose include files
+#include "Std_Defines.h"
+
+// App required include files
+#include "ax25.h"
+#include "FX25.h"
+#include "Host.h"
+
+#ifdef FX25
+
+#define	TEST_KEYUPS (3000UL)				// Key-ups sent, every third with two frames
+#define	TEST_EXACT (4)						// Exact fits to send at least
+#define	TEST_PAYLOAD (FX25_DATA + 8)		// Longest payload sent, never fits
+#define	TEST_HEADER (16)						// Two addresses, control and PID at least
+#define	TEST_FRAME (TEST_HEADER + 8 * 7 + TEST_PAYLOAD + 2)	// Bytes kept
+#define	AIR_BITS (16384)						// On-air bits kept per key-up
+#define	BLOCK (FX25_DATA + FX25_CHECK)		// Code word bytes
+#define	TEST_RESIDUE (0xF0B8)				// FCS register after a good frame and its FCS
+
+// The correlation tags from the FX.25 specification, for FX25_DATA
+#if FX25_DATA == 239
+#define	TEST_TAG 0xB74DB7DF8A532F3EULL		// Tag_01
+#elif FX25_DATA == 128
+#define	TEST_TAG 0x26FF60A600CC8FDEULL		// Tag_02
+#elif FX25_DATA == 64
+#define	TEST_TAG 0xC7DC0508F3D9B09EULL		// Tag_03
+#else
+#define	TEST_TAG 0x8F056EB4369660EEULL		// Tag_04
+#endif
+
+// Static functions
+static void TestSend(unsigned long keyup, unsigned char count);
+static void TestBit(void);
+static void TestKeyup(unsigned long keyup, unsigned char count);
+static unsigned short TestDeframe(unsigned short *at, unsigned short *start);
+static unsigned char TestTagged(unsigned short at);
+static void TestBlock(unsigned short start, unsigned short end);
+static unsigned char TestCorrect(unsigned char *block, unsigned short length);
+static void TestField(void);
+static unsigned char TestMultiply(unsigned char a, unsigned char b);
+static unsigned char TestDivide(unsigned char a, unsigned char b);
+
+static unsigned char	air[AIR_BITS];			// Bits sent, NRZI undone
+static unsigned short	air_bits;				// How many
+static unsigned char	payload[2][TEST_PAYLOAD];	// What each frame carried
+static unsigned short	payload_length[2];
+static unsigned char	frame[TEST_FRAME];		// Last frame deframed, with FCS
+static unsigned char	gf_exp[2 * 255];		// Powers of alpha, twice over
+static unsigned char	gf_log[256];
+static unsigned long	failures;
+static unsigned long	tagged, exact, plain;	// Frames coded, exactly, or not
+
+
+/******************************************************************************/
+extern int main(void)
+/*******************************************************************************
+* ABSTRACT:	Sends key-ups of one or two frames with random payloads, from
+*				empty to too long for the code block, and checks each one.
+*				Then sends frames sized to fill the block exactly.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	0 if every check passed, 1 otherwise
+*/
+{
+	unsigned long	keyup, loop;
+	unsigned char	count, index;
+
+	TestField();
+	HostInit();
+	host_bit_watch = TestBit;
+	srand(1);
+
+	for (keyup = 0 ; keyup < TEST_KEYUPS ; keyup++)
+	{
+		count = (keyup % 3 == 2)? 2 : 1;
+		for (index = 0 ; index < count ; index++)
+		{
+			payload_length[index] = rand() % (TEST_PAYLOAD + 1);
+		}
+		TestSend(keyup, count);
+	}
+
+	// Random sizes seldom fill the block exactly, so aim for it: a frame
+	// a few bytes short fits exactly when its stuffed bits make them up
+	for (loop = 0 ; (exact < TEST_EXACT) && (loop < TEST_KEYUPS) ; loop++)
+	{
+		payload_length[0] = FX25_DATA - TEST_HEADER - 4 - rand() % 6;
+		TestSend(keyup++, 1);
+	}
+
+	// The sizes must have covered both sides of the limit, and the edge
+	if (!tagged || (exact < TEST_EXACT) || !plain)
+	{
+		++failures;
+		printf("Not every case was sent\n");
+	}
+
+	printf("Test_Fx25, RS(%u,%u): %lu frames coded, %lu exact fits, %lu too long: %s\n",
+				BLOCK, FX25_DATA, tagged, exact, plain, failures? "FAILED" : "passed");
+	return(failures? 1 : 0);
+
+}		// End main(void)
+
+
+/******************************************************************************/
+static void TestSend(unsigned long keyup, unsigned char count)
+/*******************************************************************************
+* ABSTRACT:	Fills the payloads with random bytes, sends them as one key-up
+*				and checks what went on air.
+*
+* INPUT:		keyup				Key-up number, for messages
+*				count				Frames to send, 1 or 2
+*				payload_length	Payload bytes of each
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	unsigned char	index;
+	unsigned short	loop;
+
+	for (index = 0 ; index < count ; index++)
+	{
+		for (loop = 0 ; loop < payload_length[index] ; loop++)
+		{
+			payload[index][loop] = rand();
+		}
+	}
+
+	air_bits = 0;
+	for (index = 0 ; index < count ; index++)
+	{
+		ax25sendHeader();
+		for (loop = 0 ; loop < payload_length[index] ; loop++)
+		{
+			ax25sendByte(payload[index][loop]);
+		}
+		ax25sendFooter();
+	}
+	ax25sendEnd();
+	ax25sendWait();
+	TestKeyup(keyup, count);
+	return;
+
+}		// End TestSend(unsigned long keyup, unsigned char count)
+
+
+/******************************************************************************/
+static void TestBit(void)
+/*******************************************************************************
+* ABSTRACT:	Called after each bit ISR. Keeps the data bit that went on air:
+*				a one if the tone or, with G3RUH, the unscrambled line level
+*				did not change. The call that unkeys sends nothing and adds
+*				a stray bit after the tail, which no check reaches.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+#ifdef G3RUH
+	static unsigned long	lfsr;				// Last 17 scrambled bits
+	static unsigned char	last;				// Line level of the previous bit
+	unsigned char	scrambled, level;
+
+	scrambled = txtone & 1;
+	level = (scrambled ^ (unsigned char)(lfsr >> 11) ^ (unsigned char)(lfsr >> 16)) & 1;
+	lfsr = (lfsr << 1) | scrambled;
+#else
+	static unsigned short	last;				// Tone of the previous bit
+	unsigned short	level;
+
+	level = txtone;
+#endif
+
+	if (air_bits < AIR_BITS) air[air_bits++] = (level == last);
+	last = level;
+	return;
+
+}		// End TestBit(void)
+
+
+/******************************************************************************/
+static void TestKeyup(unsigned long keyup, unsigned char count)
+/*******************************************************************************
+* ABSTRACT:	Checks one key-up: each frame decodes as plain AX.25 with its
+*				payload after a tag, its code block is checked if it fits,
+*				and no other tag appears.
+*
+* INPUT:		keyup		Key-up number, for messages
+*				count		Frames sent in it
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	unsigned short	at, start, length, span, loop;
+	unsigned char	index, tags;
+
+	at = 0;
+	for (index = 0 ; index < count ; index++)
+	{
+		length = TestDeframe(&at, &start);
+		if ((length < TEST_HEADER + payload_length[index] + 2)
+			|| memcmp(frame + length - 2 - payload_length[index], payload[index],
+															payload_length[index]))
+		{
+			if (++failures <= 10)
+			{
+				printf("Key-up %lu frame %u, %u byte payload: not received\n",
+										keyup, index, payload_length[index]);
+			}
+			return;
+		}
+
+		span = at - start;						// Flags and frame, on air
+		if ((start < 64) || !TestTagged(start - 64))
+		{
+			if (++failures <= 10)
+			{
+				printf("Key-up %lu frame %u is not tagged\n", keyup, index);
+			}
+		}
+		else if (span <= FX25_DATA * 8)
+		{
+			++tagged;
+			if (span == FX25_DATA * 8) ++exact;
+			TestBlock(start, at);
+		}
+		else
+		{
+			++plain;
+		}
+	}
+
+	tags = 0;
+	for (loop = 0 ; loop + 64 <= air_bits ; loop++)
+	{
+		tags += TestTagged(loop);
+	}
+	if ((tags != count) && (++failures <= 10))
+	{
+		printf("Key-up %lu: %u tags for %u frames\n", keyup, tags, count);
+	}
+	return;
+
+}		// End TestKeyup(unsigned long keyup, unsigned char count)
+
+
+/******************************************************************************/
+static unsigned short TestDeframe(unsigned short *at, unsigned short *start)
+/*******************************************************************************
+* ABSTRACT:	Finds the next frame with a good FCS, as a plain AX.25 receiver
+*				does: between two flags, stuffed zeros removed, a whole number
+*				of bytes. Anything else between flags, such as a tag or
+*				parity, is ignored.
+*
+* INPUT:		*at		First on-air bit to look at
+* OUTPUT:	*at		The bit after the frame's closing flag
+*				*start	The first bit of its opening flag
+*				frame		The frame, FCS included
+* RETURN:	Frame length in bytes, or 0 if there is none
+*/
+{
+	static unsigned char	bits[AIR_BITS];	// Data bits since the last flag
+	unsigned short	count, length, loop, opening, crc;
+	unsigned char	ones, inframe;
+
+	ones = 0;
+	count = 0;
+	opening = 0;
+	inframe = FALSE;
+	for ( ; *at < air_bits ; ++*at)
+	{
+		if (air[*at])
+		{
+			if (++ones > 6) inframe = FALSE;	// Abort, or an idle line
+			bits[count++] = 1;
+		}
+		else if (ones == 5)					// A stuffed zero
+		{
+			ones = 0;
+		}
+		else if (ones == 6)					// A flag ends here
+		{
+			ones = 0;
+			length = (count - 7) / 8;		// Less the flag's first seven bits
+			if (inframe && (count >= 7 + 8 * 3) && !((count - 7) % 8)
+				&& (length <= TEST_FRAME))
+			{
+				crc = CRC_INIT;					// Frames run past 255 bytes
+				for (loop = 0 ; loop < length * 8 ; loop++)
+				{
+					frame[loop / 8] >>= 1;
+					if (bits[loop]) frame[loop / 8] |= 0x80;
+					if (loop % 8 == 7) crc = ax25crcByte(crc, frame[loop / 8]);
+				}
+				if (crc == TEST_RESIDUE)
+				{
+					*start = opening;
+					++*at;
+					return(length);
+				}
+			}
+			inframe = TRUE;
+			opening = *at - 7;
+			count = 0;
+		}
+		else
+		{
+			ones = 0;
+			bits[count++] = 0;
+		}
+	}
+
+	return(0);
+
+}		// End TestDeframe(unsigned short *at, unsigned short *start)
+
+
+/******************************************************************************/
+static unsigned char TestTagged(unsigned short at)
+/*******************************************************************************
+* ABSTRACT:	Checks for the correlation tag, least significant bit first.
+*
+* INPUT:		at			First on-air bit of the tag
+* OUTPUT:	None
+* RETURN:	TRUE if the 64 bits from there are the tag
+*/
+{
+	unsigned char	loop;
+
+	for (loop = 0 ; loop < 64 ; loop++)
+	{
+		if (air[at + loop] != ((TEST_TAG >> loop) & 1)) return(FALSE);
+	}
+
+	return(TRUE);
+
+}		// End TestTagged(unsigned short at)
+
+
+/******************************************************************************/
+static void TestBlock(unsigned short start, unsigned short end)
+/*******************************************************************************
+* ABSTRACT:	Checks the code block after a tag: flags from the frame's end to
+*				FX25_DATA bytes, then parity that leaves no syndrome. Then
+*				corrupts 1 to FX25_CHECK / 2 random bytes, and checks they
+*				are all found and put right.
+*
+* INPUT:		start		First on-air bit of the block
+*				end		The bit after the frame's closing flag
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	unsigned char	block[BLOCK], copy[BLOCK];
+	unsigned char	errors, corrected;
+	unsigned short	loop, place;
+
+	if (start + BLOCK * 8 > air_bits)
+	{
+		++failures;
+		printf("Code block at bit %u cut short\n", start);
+		return;
+	}
+	for (loop = 0 ; loop < BLOCK * 8 ; loop++)
+	{
+		block[loop / 8] >>= 1;
+		if (air[start + loop]) block[loop / 8] |= 0x80;
+	}
+
+	for (loop = end ; loop < start + FX25_DATA * 8 ; loop++)
+	{
+		if ((air[loop] != ((0x7E >> ((loop - end) & 7)) & 1)) && (++failures <= 10))
+		{
+			printf("Code block at bit %u: padding is not flags\n", start);
+			break;
+		}
+	}
+
+	memcpy(copy, block, BLOCK);
+	if ((TestCorrect(copy, BLOCK) != 0) && (++failures <= 10))
+	{
+		printf("Code block at bit %u: parity is wrong\n", start);
+		return;
+	}
+
+	for (errors = 1 ; errors <= FX25_CHECK / 2 ; errors++)
+	{
+		memcpy(copy, block, BLOCK);
+		for (loop = 0 ; loop < errors ; )
+		{
+			place = rand() % BLOCK;
+			if (copy[place] == block[place])	// Each error in a new byte
+			{
+				copy[place] ^= 1 + rand() % 255;
+				loop++;
+			}
+		}
+		corrected = TestCorrect(copy, BLOCK);
+		if (((corrected != errors) || memcmp(copy, block, BLOCK)) && (++failures <= 10))
+		{
+			printf("Code block at bit %u: %u errors, %u corrected\n",
+												start, errors, corrected);
+		}
+	}
+	return;
+
+}		// End TestBlock(unsigned short start, unsigned short end)
+
+
+/******************************************************************************/
+static unsigned char TestCorrect(unsigned char *block, unsigned short length)
+/*******************************************************************************
+* ABSTRACT:	Decodes a Reed-Solomon code word whose generator has the roots
+*				alpha^1 to alpha^FX25_CHECK, first byte the highest power:
+*				syndromes, Berlekamp-Massey for the error locator, a Chien
+*				search for the places and Forney for the values.
+*
+* INPUT:		*block	Code word, data then parity
+*				length	Its length in bytes, at most 255
+* OUTPUT:	*block	Corrected, if it could be
+* RETURN:	Bytes corrected, or 0xFF if there were too many errors
+*/
+{
+	unsigned char	syndrome[FX25_CHECK], omega[FX25_CHECK];
+	unsigned char	lambda[FX25_CHECK + 1], prior[FX25_CHECK + 1], saved[FX25_CHECK + 1];
+	unsigned char	errors, shift, last, discrepancy, value, slope, found, any;
+	unsigned short	loop, index, power;
+
+	// Syndromes: the word at each root of the generator
+	any = 0;
+	for (index = 0 ; index < FX25_CHECK ; index++)
+	{
+		value = 0;
+		for (loop = 0 ; loop < length ; loop++)
+		{
+			value = TestMultiply(value, gf_exp[index + 1]) ^ block[loop];
+		}
+		syndrome[index] = value;
+		any |= value;
+	}
+	if (!any) return(0);
+
+	// Berlekamp-Massey: the shortest locator that generates the syndromes
+	memset(lambda, 0, sizeof(lambda));
+	memset(prior, 0, sizeof(prior));
+	lambda[0] = prior[0] = 1;
+	errors = 0;
+	shift = 1;
+	last = 1;
+	for (index = 0 ; index < FX25_CHECK ; index++)
+	{
+		discrepancy = syndrome[index];
+		for (loop = 1 ; loop <= errors ; loop++)
+		{
+			discrepancy ^= TestMultiply(lambda[loop], syndrome[index - loop]);
+		}
+		if (!discrepancy)
+		{
+			shift++;
+			continue;
+		}
+		memcpy(saved, lambda, sizeof(lambda));
+		value = TestDivide(discrepancy, last);
+		for (loop = 0 ; loop + shift <= FX25_CHECK ; loop++)
+		{
+			lambda[loop + shift] ^= TestMultiply(value, prior[loop]);
+		}
+		if (2 * errors <= index)
+		{
+			errors = index + 1 - errors;
+			memcpy(prior, saved, sizeof(prior));
+			last = discrepancy;
+			shift = 1;
+		}
+		else
+		{
+			shift++;
+		}
+	}
+	if (errors > FX25_CHECK / 2) return(0xFF);
+
+	// Evaluator: syndromes times locator, less the powers past FX25_CHECK
+	for (index = 0 ; index < FX25_CHECK ; index++)
+	{
+		omega[index] = 0;
+		for (loop = 0 ; (loop <= index) && (loop <= errors) ; loop++)
+		{
+			omega[index] ^= TestMultiply(lambda[loop], syndrome[index - loop]);
+		}
+	}
+
+	// Chien search over the bytes there are, Forney for each value. An
+	// error at power p of the word is a root of the locator at alpha^-p.
+	found = 0;
+	for (power = 0 ; power < length ; power++)
+	{
+		value = 0;
+		for (loop = errors + 1 ; loop-- ; )
+		{
+			value = TestMultiply(value, gf_exp[(255 - power) % 255]) ^ lambda[loop];
+		}
+		if (value) continue;
+
+		for (loop = FX25_CHECK ; loop-- ; )
+		{
+			value = TestMultiply(value, gf_exp[(255 - power) % 255]) ^ omega[loop];
+		}
+		slope = 0;								// The locator's derivative
+		for (loop = 1 ; loop <= errors ; loop += 2)
+		{
+			slope ^= TestMultiply(lambda[loop], gf_exp[((255 - power) * (loop - 1)) % 255]);
+		}
+		if (!slope) return(0xFF);
+		block[length - 1 - power] ^= TestDivide(value, slope);
+		found++;
+	}
+
+	return((found == errors)? found : 0xFF);
+
+}		// End TestCorrect(unsigned char *block, unsigned short length)
+
+
+/******************************************************************************/
+static void TestField(void)
+/*******************************************************************************
+* ABSTRACT:	Builds the power and log tables of GF(256) over the FX.25
+*				polynomial, x^8 + x^4 + x^3 + x^2 + 1.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	unsigned short	power, value;
+
+	value = 1;
+	for (power = 0 ; power < 255 ; power++)
+	{
+		gf_exp[power] = gf_exp[power + 255] = value;
+		gf_log[value] = power;
+		value <<= 1;
+		if (value & 0x100) value ^= 0x11D;
+	}
+	return;
+
+}		// End TestField(void)
+
+
+/******************************************************************************/
+static unsigned char TestMultiply(unsigned char a, unsigned char b)
+/*******************************************************************************
+* ABSTRACT:	Multiplies in GF(256), by logs.
+*
+* INPUT:		a, b			Field elements
+* OUTPUT:	None
+* RETURN:	a times b
+*/
+{
+	return((a && b)? gf_exp[gf_log[a] + gf_log[b]] : 0);
+
+}		// End TestMultiply(unsigned char a, unsigned char b)
+
+
+/******************************************************************************/
+static unsigned char TestDivide(unsigned char a, unsigned char b)
+/*******************************************************************************
+* ABSTRACT:	Divides in GF(256), by logs.
+*
+* INPUT:		a, b			Field elements, b not zero
+* OUTPUT:	None
+* RETURN:	a over b
+*/
+{
+	return(a? gf_exp[gf_log[a] + 255 - gf_log[b]] : 0);
+
+}		// End TestDivide(unsigned char a, unsigned char b)
+
+#else
+
+
+/******************************************************************************/
+extern int main(void)
+/*******************************************************************************
+* ABSTRACT:	Without FX25 built in there is nothing to receive.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	0
+*/
+{
+	printf("Test_Fx25: FX25 not built in, skipped\n");
+	return(0);
+
+}		// End main(void)
+
+#endif
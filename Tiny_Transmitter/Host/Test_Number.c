@@ -0,0 +1,213 @@
+/*******************************************************************************
+File:			Test_Number.c
+
+				Checks the decimal conversions in Number.c against the C
+				library and exact integer arithmetic. NumFormat and NumParse
+				are checked on every value below 2^24, around every power of
+				ten and on a spread across the rest of the 32 bit range; run
+				"Test_Number full" to check all 2^32 values, which takes some
+				minutes. NumMetersToFeet is checked over its whole range.
+
+Functions:	extern int main(int argc, char **argv)
+				static void TestFormat(unsigned long value, unsigned char width)
+				static void TestSequence(unsigned long first, unsigned long last)
+
+*******************************************************************************/
+
+// OS headers
+#include <stdio.h>
+#include <string.h>
+
+// General purpose include files
+#include "Std_Defines.h"
+
+// App required include files
+#include "Number.h"
+
+#define	TEST_SPAN (1UL << 24)				// Values checked one by one by default
+#define	TEST_FEET_MAX (34359736UL)			// Largest dm NumMetersToFeet takes in 32 bits
+
+static unsigned long	failures;
+
+
+/******************************************************************************/
+static void TestFormat(unsigned long value, unsigned char width)
+/*******************************************************************************
+* ABSTRACT:	Checks one NumFormat call against printf, and parses it back.
+*
+* INPUT:		value		Number to convert
+*				width		Least number of digits
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	char	expect[NUM_DIGITS + 2];
+	char	buffer[NUM_DIGITS + 2];
+	unsigned char	count;
+
+	snprintf(expect, sizeof(expect), "%0*lu", width, value);
+	count = NumFormat(buffer, value, width);
+	if ((strcmp(buffer, expect) || (count != strlen(expect))) && (++failures <= 10))
+	{
+		printf("NumFormat(%lu, %u) = \"%s\" (%u), expected \"%s\"\n",
+										value, width, buffer, count, expect);
+	}
+	if ((NumParse((unsigned char *)buffer, 0) != value) && (++failures <= 10))
+	{
+		printf("NumParse(\"%s\", 0) = %lu\n", buffer,
+										NumParse((unsigned char *)buffer, 0));
+	}
+	return;
+
+}		// End TestFormat(unsigned long value, unsigned char width)
+
+
+/******************************************************************************/
+static void TestSequence(unsigned long first, unsigned long last)
+/*******************************************************************************
+* ABSTRACT:	Checks NumFormat and NumParse on every value from first to last.
+*				The expected digits are counted up alongside rather than
+*				printed, so a full 2^32 sweep stays within minutes.
+*
+* INPUT:		first		First value
+*				last		Last value, inclusive
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	char	expect[NUM_DIGITS + 2];
+	char	buffer[NUM_DIGITS + 2];
+	unsigned char	length;
+	unsigned char	index;
+	unsigned long	value;
+
+	length = snprintf(expect, sizeof(expect), "%lu", first);
+	for (value = first ; ; value++)
+	{
+		if ((NumFormat(buffer, value, 0) != length) || memcmp(buffer, expect, length + 1)
+			|| (NumParse((unsigned char *)buffer, 0) != value))
+		{
+			if (++failures <= 10)
+			{
+				printf("NumFormat(%lu, 0) = \"%s\", expected \"%s\"\n",
+												value, buffer, expect);
+			}
+		}
+		if (value == last) break;
+
+		for (index = length ; index-- && (++expect[index] > '9') ; )
+		{
+			expect[index] = '0';				// Carry into the next digit
+		}
+		if (expect[0] == '0')				// Carried out of the top digit
+		{
+			memmove(expect + 1, expect, ++length);
+			expect[0] = '1';
+		}
+	}
+	return;
+
+}		// End TestSequence(unsigned long first, unsigned long last)
+
+
+/******************************************************************************/
+extern int main(int argc, char **argv)
+/*******************************************************************************
+* ABSTRACT:	Runs the checks, printing the first few mismatches.
+*
+* INPUT:		argv[1]	"full" to sweep NumFormat over every 32 bit value
+* OUTPUT:	None
+* RETURN:	0 if every check passed, 1 otherwise
+*/
+{
+	char	string[24];
+	unsigned long	value, power, expect;
+	unsigned char	width;
+
+	// NumFormat and NumParse, one by one
+	if ((argc > 1) && !strcmp(argv[1], "full"))
+	{
+		TestSequence(0, 0xFFFFFFFFUL);
+	}
+	else
+	{
+		TestSequence(0, TEST_SPAN - 1);
+		for (value = TEST_SPAN ; value <= 0xFFFFFFFFUL - 65521 ; value += 65521)
+		{
+			TestFormat(value, 0);
+		}
+	}
+
+	// Every digit count change above 9999, the top of the range, and zero
+	// padding
+	for (power = 10000 ; power <= 1000000000UL ; power *= 10)
+	{
+		TestSequence(power - 1000, power + 1000);
+	}
+	TestSequence(0xFFFFFFFFUL - 100000, 0xFFFFFFFFUL);
+	for (width = 0 ; width <= NUM_DIGITS ; width++)
+	{
+		for (power = 1 ; power <= 1000000000UL ; power *= 10)
+		{
+			TestFormat(power - 1, width);
+			TestFormat(power, width);
+		}
+		TestFormat(0xFFFFFFFFUL, width);
+	}
+
+	// NumParse with decimals: kept, padded with zeros, or dropped
+	for (value = 0 ; value < 10000000UL ; value++)
+	{
+		snprintf(string, sizeof(string), "%lu.%03lu", value / 1000, value % 1000);
+		if (((NumParse((unsigned char *)string, 3) != value)
+			|| (NumParse((unsigned char *)string, 1) != value / 100)
+			|| (NumParse((unsigned char *)string, 5) != value * 100))
+			&& (++failures <= 20))
+		{
+			printf("NumParse(\"%s\") with 3, 1 and 5 decimals = %lu, %lu, %lu\n",
+							string, NumParse((unsigned char *)string, 3),
+							NumParse((unsigned char *)string, 1),
+							NumParse((unsigned char *)string, 5));
+		}
+	}
+	if ((NumParse((unsigned char *)"", 2) != 0)
+		|| (NumParse((unsigned char *)"-12.5", 1) != 0)
+		|| (NumParse((unsigned char *)"12.", 2) != 1200)
+		|| (NumParse((unsigned char *)".5", 1) != 5)
+		|| (NumParse((unsigned char *)"1234.5,M", 2) != 123450))
+	{
+		++failures;
+		printf("NumParse fails on an empty, signed or partial field\n");
+	}
+
+	// NumRound: speed and course fields, rounded to nearest, to 65535
+	for (value = 0 ; value < 655350UL ; value++)
+	{
+		snprintf(string, sizeof(string), "%lu.%lu", value / 10, value % 10);
+		if ((NumRound((unsigned char *)string) != (value + 5) / 10) && (++failures <= 30))
+		{
+			printf("NumRound(\"%s\") = %u\n", string, NumRound((unsigned char *)string));
+		}
+	}
+
+	// NumMetersToFeet against exact arithmetic, over the range that fits
+	// the chip's 32 bit long
+	for (value = 0 ; value <= TEST_FEET_MAX ; value++)
+	{
+		expect = (unsigned long)(((unsigned long long)value * 250 + 381) / 762);
+		if ((NumMetersToFeet(value) != expect) && (++failures <= 40))
+		{
+			printf("NumMetersToFeet(%lu) = %lu, expected %lu\n", value,
+												NumMetersToFeet(value), expect);
+		}
+	}
+	if ((unsigned long long)TEST_FEET_MAX * 125 + 190 > 0xFFFFFFFFUL)
+	{
+		++failures;
+		printf("NumMetersToFeet overflows 32 bits below %lu dm\n", TEST_FEET_MAX);
+	}
+
+	printf("Test_Number: %s\n", failures? "FAILED" : "passed");
+	return(failures? 1 : 0);
+
+}		// End main(int argc, char **argv)
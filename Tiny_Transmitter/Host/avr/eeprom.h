@@ -0,0 +1,22 @@
+/*******************************************************************************
+File:			avr/eeprom.h
+
+				Host stand-in for avr-libc EEPROM access. The firmware reads
+				fixed EEPROM addresses (EE_TXDELAY, EE_BEACON, ...), so the
+				EEPROM is the host_eeprom array in Host.c, indexed by them.
+
+*******************************************************************************/
+
+#ifndef HOST_AVR_EEPROM_H
+#define HOST_AVR_EEPROM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define	EEMEM
+
+extern uint8_t	eeprom_read_byte(const uint8_t *address);
+extern uint16_t	eeprom_read_word(const uint16_t *address);
+extern void		eeprom_read_block(void *buffer, const void *address, size_t length);
+
+#endif
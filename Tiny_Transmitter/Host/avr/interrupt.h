@@ -0,0 +1,18 @@
+/*******************************************************************************
+File:			avr/interrupt.h
+
+				Host stand-in for avr-libc interrupts. ISR(vector) becomes an
+				ordinary function named after the vector, so a test or
+				benchmark "fires" an interrupt by calling it.
+
+*******************************************************************************/
+
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+#define	ISR(vector, ...)	void vector(void); void vector(void)
+#define	ISR_NOBLOCK
+#define	sei()
+#define	cli()
+
+#endif
@@ -0,0 +1,97 @@
+/*******************************************************************************
+File:			avr/io.h
+
+				Host stand-in for the avr-libc ATtiny4313 register file. Each
+				I/O register is a plain variable defined in Host.c, so the
+				firmware reads and writes them as it would on the chip.
+
+*******************************************************************************/
+
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+#include <stdint.h>
+
+// 8-bit I/O registers
+extern volatile uint8_t	PORTB, DDRB, PINB, PORTD, DDRD, PIND;
+extern volatile uint8_t	TCCR0A, TCCR0B, TCNT0, OCR0A, OCR0B;
+extern volatile uint8_t	TCCR1A, TCCR1B, TCCR1C, TIMSK, TIFR;
+extern volatile uint8_t	UBRRH, UBRRL, UCSRA, UCSRB, UCSRC, UDR;
+extern volatile uint8_t	ACSR, DIDR, WDTCR, MCUCR, GPIOR0, GPIOR1, GPIOR2;
+
+// 16-bit Timer1 registers
+extern volatile uint16_t	TCNT1, OCR1A, OCR1B, ICR1;
+
+// TCCR0A, TCCR0B
+#define	WGM00		0
+#define	WGM01		1
+#define	CS00		0
+#define	CS01		1
+#define	CS02		2
+#define	WGM02		3
+
+// TCCR1B
+#define	CS10		0
+#define	CS11		1
+#define	CS12		2
+#define	WGM12		3
+#define	WGM13		4
+#define	ICES1		6
+#define	ICNC1		7
+
+// TIMSK, TIFR
+#define	OCIE0A		0
+#define	TOIE0		1
+#define	OCIE0B		2
+#define	ICIE1		3
+#define	OCIE1B		5
+#define	OCIE1A		6
+#define	TOIE1		7
+#define	OCF0A		0
+#define	TOV0		1
+#define	OCF0B		2
+#define	ICF1		3
+#define	OCF1B		5
+#define	OCF1A		6
+#define	TOV1		7
+
+// UCSRA, UCSRB, UCSRC
+#define	DOR			3
+#define	FE			4
+#define	UDRE		5
+#define	TXC			6
+#define	RXC			7
+#define	TXEN		3
+#define	RXEN		4
+#define	UDRIE		5
+#define	TXCIE		6
+#define	RXCIE		7
+#define	UCSZ0		1
+#define	UCSZ1		2
+#define	UMSEL		6
+
+// ACSR, DIDR
+#define	ACIS0		0
+#define	ACIS1		1
+#define	ACIC		2
+#define	ACIE		3
+#define	ACI			4
+#define	ACO			5
+#define	ACBG		6
+#define	ACD			7
+#define	AIN0D		0
+#define	AIN1D		1
+
+// WDTCR, MCUCR
+#define	WDE			3
+#define	WDCE		4
+#define	WDIE		6
+#define	SM0			4
+#define	SE			5
+#define	SM1			6
+
+#define	RAMSTART	(0x60)
+#define	RAMEND		(0x15F)
+#define	E2END		(0xFF)
+
+#endif
@@ -0,0 +1,24 @@
+/*******************************************************************************
+File:			avr/pgmspace.h
+
+				Host stand-in for avr-libc flash access. There is one address
+				space, so the flash reads are plain memory reads. A dword is
+				read through the table's own type, since a host long can be
+				64 bits.
+
+*******************************************************************************/
+
+#ifndef HOST_AVR_PGMSPACE_H
+#define HOST_AVR_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define	PROGMEM
+#define	PSTR(s)				(s)
+#define	pgm_read_byte(a)	(*(const uint8_t *)(a))
+#define	pgm_read_word(a)	(*(const uint16_t *)(a))
+#define	pgm_read_dword(a)	((uint32_t)*(a))
+#define	memcpy_P(d, s, n)	memcpy((d), (s), (n))
+
+#endif
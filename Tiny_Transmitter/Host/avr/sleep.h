@@ -0,0 +1,18 @@
+/*******************************************************************************
+File:			avr/sleep.h
+
+				Host stand-in for avr-libc sleep. The host never sleeps;
+				Host.c plays the bit interrupt from mainIdle() instead.
+
+*******************************************************************************/
+
+#ifndef HOST_AVR_SLEEP_H
+#define HOST_AVR_SLEEP_H
+
+#define	SLEEP_MODE_IDLE	(0)
+#define	set_sleep_mode(mode)
+#define	sleep_enable()
+#define	sleep_disable()
+#define	sleep_cpu()
+
+#endif
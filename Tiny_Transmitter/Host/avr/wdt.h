@@ -0,0 +1,13 @@
+/*******************************************************************************
+File:			avr/wdt.h
+
+				Host stand-in for the avr-libc watchdog.
+
+*******************************************************************************/
+
+#ifndef HOST_AVR_WDT_H
+#define HOST_AVR_WDT_H
+
+#define	wdt_reset()
+
+#endif
@@ -4,11 +4,25 @@ File:			Message_Create.c
  				Messaging subsystem function library for the atmega8.
 
 Functions:	extern void MsgInit (void)
+				extern void MsgConfigure (void)
 				extern void MsgPrepare (void)
+				extern void MsgRelease (void)
+				extern unsigned char MsgBeaconDue (void)
 				extern void MsgSendPos (void)
+				static void MsgSendTime (void)
+				static unsigned long MsgHundredths (unsigned char *string)
+				static unsigned long MsgHundredths (signed long position)
+				static void MsgSendMinutes (unsigned long position,
+												unsigned char width)
+				static void MsgSendBase91 (unsigned long value,
+												unsigned char digits)
+				static void MsgSendCompressed (void)
+				static void MsgMicEDestination (void)
+				static void MsgSendMicE (void)
 				extern void MsgSendTelem (void)
 		extern void MsgSendAck (unsigned char *rxbytes, unsigned char msg_start)
-				extern void SerHandler (unsigned char newchar);
+				extern void MsgHandler (unsigned char newchar);	(NMEA)
+				extern void MsgHandler (unsigned char newchar);	(UBX)
 
 Revisions:	1.00	11/02/04	GND	Gary Dion
 				1.01	11/28/04	GND	Added MsgSendAck routine
@@ -33,6 +47,9 @@ Copyright:	(c)2005, Gary N. Dion (me@garydion.com). All rights reserved.
 #include <avr/eeprom.h>
 #include <avr/interrupt.h>
 #include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <stddef.h>
+#include <stdint.h>
 
 // General purpose include files
 #include "Std_Defines.h"
@@ -41,29 +58,183 @@ Copyright:	(c)2005, Gary N. Dion (me@garydion.com). All rights reserved.
 #include "ax25.h"
 #include "Message_Create.h"
 #include "GPS_Receive.h"
+#include "Number.h"
+#include "Analog.h"
 
+#ifdef GPS_UBX
+// UBX parser states
+#define	UBX_SKIP		(0)					// Looking for the first sync byte
+#define	UBX_SYNC		(1)					// Got 0xB5, want 0x62
+#define	UBX_HEADER	(2)					// Class, ID and length
+#define	UBX_DATA		(3)					// Payload
+#define	UBX_CK_A		(4)					// First checksum byte
+#define	UBX_CK_B		(5)					// Second checksum byte
+
+#define	UBX_PVT_LEN	(92)					// NAV-PVT payload bytes
+
+// One GPS fix, straight from NAV-PVT. Fields are in the receiver's little
+// endian order, which is also the AVR's, so the parser copies bytes in.
+// They are exactly 32 bits, as in the message, on the host build too.
+struct GpsFix
+{
+	unsigned char	Time[3];			// UTC hour, minute and second
+	unsigned char	Satellites;			// Satellites used in the solution
+	int32_t			Longitude;			// Degrees times 10^7, East positive
+	int32_t			Latitude;			// Degrees times 10^7, North positive
+	int32_t			Altitude;			// Above mean sea level, millimeters
+	int32_t			Speed;				// Ground speed, millimeters per second
+	int32_t			Course;				// Heading of motion, degrees times 10^5
+};
+
+// Knots and degrees: a knot is 514.444 mm/s, so 35/18000 is within 0.03%
+#define	FixKnots(f)		(((f)->Speed * 35 + 9000) / 18000)
+#define	FixDegrees(f)	(((f)->Course + 50000) / 100000)
+#define	FixSouth(f)		((f)->Latitude < 0)
+#define	FixWest(f)		((f)->Longitude < 0)
+#else
 #define	GPRMC		(1)
 #define	GPGGA		(2)
+#define	GPBOTH	(GPRMC | GPGGA)
 
-static unsigned char	Time[7];				// UTC time in HHMMSS format
-static unsigned char	Latitude[10];		// Latitude in DDMM.MMMM format
-static unsigned char	Longitude[11];		// Longitude in DDDMM.MMMM format
-static unsigned char	Altitude[8];		// Altitude (meters) in MMM.MMM format
-static unsigned char	Speed[6];			// Speed (knots) in kkk.kk format
-static unsigned char	Course[6];			// Track angle (degrees) in ddd.dd format
-static unsigned char	Satellites[3];		// Number of Satellites tracked
+// NMEA parser states
+#define	NMEA_SKIP	(0)					// Ignoring characters until the next '$'
+#define	NMEA_ID		(1)					// Reading the talker and sentence ID
+#define	NMEA_DATA	(2)					// Reading the comma separated fields
+#define	NMEA_SUM_HI	(3)					// Reading the first checksum digit
+#define	NMEA_SUM_LO	(4)					// Reading the second checksum digit
 
-// Temporary variables used for decoding. Note: Time_Temp[7] is in the .h file.
-static unsigned char	Latitude_Temp[10];
-static unsigned char	Longitude_Temp[11];
-static unsigned char	Altitude_Temp[8];
-static unsigned char	Speed_Temp[6];
-static unsigned char	Course_Temp[6];
-static unsigned char	Satellites_Temp[3];
+// One GPS fix, sized to what goes on air. Each field is null terminated.
+struct GpsFix
+{
+	unsigned char	Time[7];				// UTC time in HHMMSS format
+	unsigned char	Latitude[8];		// Latitude in DDMM.MM format
+	unsigned char	NorthSouth[2];		// Latitude hemisphere, N or S
+	unsigned char	Longitude[9];		// Longitude in DDDMM.MM format
+	unsigned char	EastWest[2];		// Longitude hemisphere, E or W
+	unsigned char	Altitude[8];		// Altitude (meters) in MMM.MMM format
+	unsigned char	Speed[6];			// Speed (knots), kkk.k or k.kk
+	unsigned char	Course[6];			// Track angle (degrees), ddd.d
+	unsigned char	Satellites[3];		// Number of Satellites tracked
+};
 
-static unsigned char	Altifeet[7];		// Altitude (feet) in FFFFFF format
+#define	FixKnots(f)		NumRound((f)->Speed)
+#define	FixDegrees(f)	NumRound((f)->Course)
+#define	FixSouth(f)		((f)->NorthSouth[0] == 'S')
+#define	FixWest(f)		((f)->EastWest[0] == 'W')
+#endif
 
+// The parser fills fix[back] while the transmitter reads fix[back ^ 1].
+// A valid GPGGA + GPRMC pair (or one NAV-PVT) flips back, so every field
+// sent comes from the same epoch and nothing is copied.
+static struct GpsFix	fix[2];
+static volatile unsigned char	back;		// Index of the fix being parsed into
+static volatile unsigned char	fix_lock;	// Transmitter is reading the front fix
+#ifndef GPS_UBX
+static unsigned char	fix_seen;			// Valid sentences parsed this epoch
+static unsigned long	fix_time;			// Their UTC time, packed as in MsgHandler
+#endif
+static struct GpsFix	*tx;					// Front fix latched by MsgPrepare
+
+static char				Altifeet[7];		// Altitude (feet) in FFFFFF format
+static unsigned long	altitude_feet;		// The same altitude as a number
+static unsigned long	altitude_meters;	// Altitude before conversion to feet
+static unsigned short	speed_knots;		// Speed rounded to whole knots
+static unsigned short	course_degrees;	// Course rounded to 0-359 degrees
+
+#ifdef POS_MICE
+static unsigned char	mice_dest[7];		// Destination address with latitude
+#endif
+
+#ifndef GPS_UBX
 static unsigned char	sentence_type;		// GPRMC, GPGGA, or unrecognized
+#endif
+
+// SmartBeaconing state, see MsgBeaconDue
+static struct BeaconConfig	beacon;	// Parameters, from EEPROM at boot
+static unsigned long	beacon_ticks;		// ax25ticks() at the last beacon
+static unsigned short	beacon_course;		// Course at the last beacon
+static unsigned char	beacon_started;	// The first beacon has gone out
+
+// Defaults for unprogrammed EEPROM, tuned for a balloon: slow on the pad,
+// quick in the jet stream, and a corner peg for the turn after burst.
+static const struct BeaconConfig beacon_default PROGMEM = {
+	50,			// fast_speed, knots
+	120,			// fast_rate, seconds
+	4,				// slow_speed, knots
+	900,			// slow_rate, seconds
+	15,			// min_turn_time, seconds
+	30,			// turn_min, degrees
+	255};			// turn_slope, degrees times knots
+
+// Static functions
+static void MsgSendTime(void);
+#ifdef GPS_UBX
+static unsigned long MsgHundredths(signed long position);
+#ifndef POS_COMPRESSED
+static void MsgSendMinutes(unsigned long position, unsigned char width);
+#endif
+#elif defined(POS_COMPRESSED) || defined(POS_MICE)
+static unsigned long MsgHundredths(unsigned char *string);
+#endif
+#if defined(POS_COMPRESSED) || defined(POS_MICE)
+static void MsgSendBase91(unsigned long value, unsigned char digits);
+#endif
+#ifdef POS_COMPRESSED
+static void MsgSendCompressed(void);
+#endif
+#ifdef POS_MICE
+static void MsgMicEDestination(void);
+static void MsgSendMicE(void);
+#endif
+
+#ifdef GPS_UBX
+// Class 0x01 NAV, ID 0x07 PVT and the payload length, little endian
+static const unsigned char ubx_header[4] PROGMEM = {0x01, 0x07, UBX_PVT_LEN, 0};
+
+// Where each wanted payload field lands in the fix: payload offset, offset
+// into struct GpsFix and size. Keep in payload order, the parser walks it.
+#define	UBX_FIELD(offset, member) \
+	{offset, offsetof(struct GpsFix, member), \
+	 sizeof(((struct GpsFix *)0)->member)}
+
+static const unsigned char ubx_fields[7][3] PROGMEM = {
+	UBX_FIELD(8, Time),					// hour, min, sec
+	UBX_FIELD(23, Satellites),			// numSV
+	UBX_FIELD(24, Longitude),			// lon
+	UBX_FIELD(28, Latitude),			// lat
+	UBX_FIELD(36, Altitude),			// hMSL
+	UBX_FIELD(60, Speed),				// gSpeed
+	UBX_FIELD(64, Course)};				// headMot
+
+// CFG-MSG: NAV-PVT every solution. CFG-PRT: UART1 at 4800 baud 8N1, UBX
+// and NMEA in, UBX out only.
+static const unsigned char ubx_config[] PROGMEM = {
+	0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0x01, 0x07, 0x01, 0x13, 0x51,
+	0xB5, 0x62, 0x06, 0x00, 0x14, 0x00, 0x01, 0x00, 0x00, 0x00,
+	0xC0, 0x08, 0x00, 0x00, 0xC0, 0x12, 0x00, 0x00, 0x03, 0x00,
+	0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0xB9, 0xB8};
+#else
+// Sentence IDs we decode from any talker (GP, GN, GL, GA, GB...). Entry n
+// is sentence type n + 1, so keep the order in step with GPRMC and GPGGA.
+static const char nmea_ids[2][3] PROGMEM = {"RMC", "GGA"};
+
+// Where each wanted field lands in the fix: sentence, comma count, offset
+// into struct GpsFix and room including the terminator.
+#define	NMEA_FIELD(type, comma, member) \
+	{type, comma, offsetof(struct GpsFix, member), \
+	 sizeof(((struct GpsFix *)0)->member)}
+
+static const unsigned char nmea_fields[9][4] PROGMEM = {
+	NMEA_FIELD(GPGGA, 1, Time),
+	NMEA_FIELD(GPGGA, 2, Latitude),
+	NMEA_FIELD(GPGGA, 3, NorthSouth),
+	NMEA_FIELD(GPGGA, 4, Longitude),
+	NMEA_FIELD(GPGGA, 5, EastWest),
+	NMEA_FIELD(GPGGA, 7, Satellites),
+	NMEA_FIELD(GPGGA, 9, Altitude),
+	NMEA_FIELD(GPRMC, 7, Speed),
+	NMEA_FIELD(GPRMC, 8, Course)};
+#endif
 
 
 /******************************************************************************/
@@ -77,100 +248,177 @@ extern void MsgInit (void)
 * RETURN:	None
 */
 {
-	Speed_Temp[0] = Speed_Temp[1] = Speed_Temp[2] = '0';
-	Course_Temp[0] = Course_Temp[1] = Course_Temp[2] = '0';
-	Altitude_Temp[0] = Altitude_Temp[1] = '0';
-	Altitude_Temp[2] = '.';
+#ifndef GPS_UBX
+	unsigned char	loop;
+#endif
+
+	eeprom_read_block(&beacon, (void *)EE_BEACON, sizeof(beacon));
+	if (beacon.fast_speed == 0xFF)		// Unprogrammed, use the defaults
+	{
+		memcpy_P(&beacon, &beacon_default, sizeof(beacon));
+	}
+
+#ifndef GPS_UBX									// A zeroed binary fix is all right
+	for (loop = 0 ; loop < 2 ; loop++)
+	{
+		fix[loop].Speed[0] = fix[loop].Speed[1] = fix[loop].Speed[2] = '0';
+		fix[loop].Course[0] = fix[loop].Course[1] = fix[loop].Course[2] = '0';
+		fix[loop].Altitude[0] = fix[loop].Altitude[1] = '0';
+		fix[loop].Altitude[2] = '.';
+		fix[loop].NorthSouth[0] = 'N';
+		fix[loop].EastWest[0] = 'W';
+	}
+#endif
 	return;
 
 }		// End MsgInit
 
+#ifdef GPS_UBX
+/******************************************************************************/
+extern void MsgConfigure(void)
+/*******************************************************************************
+* ABSTRACT:	Sends the receiver the ubx_config commands, which switch it
+*				from NMEA to NAV-PVT. Call with interrupts enabled: the
+*				commands are longer than the serial output ring.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	unsigned char	loop;
+
+	for (loop = 0 ; loop < sizeof(ubx_config) ; loop++)
+	{
+		SendByte(pgm_read_byte(&ubx_config[loop]));
+	}
+	return;
+
+}		// End MsgConfigure(void)
+#endif
+
 /******************************************************************************/
 extern void MsgPrepare(void)
 /*******************************************************************************
-* ABSTRACT:	Call this function right before sending a position report for two
-*				reasons. This copies all the temp strings into transmit strings so
-*				they are not modified by the GPS receive handler.  Altitude is also
-*				converted into feet from meters.
+* ABSTRACT:	Call this function right before sending a position report. It
+*				latches the most recent complete fix so the GPS receive handler
+*				will not swap it out until MsgRelease, converts altitude into
+*				feet from meters, and rounds speed and course.
 *
 * INPUT:		None
 * OUTPUT:	None
 * RETURN:	None
 */
 {
-	static unsigned long	LongAltitude;	// Used to convert meters to feet
-	static unsigned long	LongTemp;		// Just a long temp variable
-	static unsigned char	index;			// For indexing local arrays
-	static unsigned char	count;			// Keeps track of loops	in F-to-A
+	unsigned long	decimeters;		// Altitude as parsed from the fix
 
-	for (index = 0; index < 6 ; index++)			// Grab latest Time
-		Time[index] = Time_Temp[index];
-	Time[index] = 0; 										// Terminate string
+	fix_lock = TRUE;							// Hold the front fix still
+	tx = &fix[back ^ 1];
 
-	for (index = 0; index < 9 ; index++)			// Grab latest Latitude
-		Latitude[index] = Latitude_Temp[index];
-	Latitude[index] = 0;									// Terminate string
+#ifdef GPS_UBX
+	decimeters = (tx->Altitude > 0)? tx->Altitude / 100 : 0;
+#else
+	decimeters = NumParse(tx->Altitude, 1);	// Below sea level reads as 0
+#endif
+	altitude_meters = (decimeters + 5) / 10;
+	altitude_feet = NumMetersToFeet(decimeters);
+
+	// Six characters with leading zeros for the /A= comment
+	NumFormat(Altifeet, (altitude_feet > 999999)? 999999 : altitude_feet, 6);
+
+	speed_knots = FixKnots(tx);
+	course_degrees = FixDegrees(tx);
+	if (course_degrees >= 360) course_degrees -= 360;	// 359.5 and up is north
+
+#ifdef POS_MICE
+	MsgMicEDestination();					// Latitude goes out in the header
+#endif
+	return;
 
-	for (index = 0; index < 10 ; index++)			// Grab latest Longitude
-		Longitude[index] = Longitude_Temp[index];
-	Longitude[index] = 0;								// Terminate string
+}		// End MsgPrepare(void)
 
-	for (index = 0; index < 7 ; index++)			// Grab latest Altitude
-		Altitude[index] = Altitude_Temp[index];
-	Altitude[index] = 0;									// Terminate string
+/******************************************************************************/
+extern void MsgRelease(void)
+/*******************************************************************************
+* ABSTRACT:	Call this function once the message has been queued. The GPS
+*				receive handler may then swap in the next complete fix.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	fix_lock = FALSE;
+	return;
 
-	for (index = 0; index < 5 ; index++)			// Grab latest Speed
-		Speed[index] = Speed_Temp[index];
-	Speed[index] = 0;										// Terminate string
+}		// End MsgRelease(void)
 
-	for (index = 0; index < 5 ; index++)			// Grab latest Course
-		Course[index] = Course_Temp[index];
-	Course[index] = 0;									// Terminate string
 
-	for (index = 0; index < 2 ; index++)			// Grab latest Satellites
-		Satellites[index] = Satellites_Temp[index];
-	Satellites[index] = 0;								// Terminate string
+/******************************************************************************/
+extern unsigned char MsgBeaconDue(void)
+/*******************************************************************************
+* ABSTRACT:	SmartBeaconing scheduler, polled from the main loop. The beacon
+*				interval is slow_rate below slow_speed, fast_rate above
+*				fast_speed, and fast_rate * fast_speed / speed in between.
+*				A course change larger than turn_min + turn_slope / speed
+*				sends early ("corner pegging"), but no sooner than
+*				min_turn_time after the last beacon.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	TRUE if a beacon should be sent now
+*/
+{
+	unsigned long	elapsed;			// Bit periods since the last beacon
+	unsigned long	rate;				// Beacon interval in bit periods
+	unsigned short	speed;			// Knots, from the newest fix
+	unsigned short	course;			// Degrees, from the newest fix
+	unsigned short	turn;				// Course change since the last beacon
+	unsigned char	corner;			// Turned enough to peg a beacon
 
-	index = 0;									// Reset index for this search
-	Altitude[6] = '.';						// Force last character to a '.'
-	while (Altitude[++index] != '.');	// Find the decimal in Alt string
+	fix_lock = TRUE;							// The parser may run in the RX ISR
+	speed = FixKnots(&fix[back ^ 1]);
+	course = FixDegrees(&fix[back ^ 1]);
+	fix_lock = FALSE;
+	elapsed = ax25ticks() - beacon_ticks;
 
-	LongAltitude = 0;							// Begin with a blank slate
-	while (index)			// This is Float-to-A, working from the decimal leftward
+	if (speed <= beacon.slow_speed)
 	{
-		LongAltitude += (Altitude[--index] - 48) * LongTemp; // Right to left
-		LongTemp *= 10;						// Each digit is worth 10x previous
+		rate = beacon.slow_rate;				// Parked, or floating at ceiling
+		corner = FALSE;							// Course is noise when this slow
 	}
-	// The LongAltitude variable now contains the altitude in meters.
-
-	// The following is an approximation of 3.28 to convert Meters to Feet
-	LongAltitude *= 3;						// Start by multiplying by 3
-	LongAltitude += LongAltitude>>4;		// add to self/16  (3.1875)
-	LongAltitude += LongAltitude>>6;		// add to self/64  (3.2373)
-	LongAltitude += LongAltitude>>7;		// add to self/128 (3.2626)
-	LongAltitude += LongAltitude>>8;		// add to self/256 (3.2758)
-	LongAltitude += LongAltitude>>10;	// add to self/1024 (3.279)
-	// The LongAltitude variable now contains the altitude in feet.
-
-	// This converts a long to ASCII with six characters & leading zeros.
-	count = 0;									// Convert to character each cycle
-	index = 0;									// Start on left and work right
-	for (LongTemp = 100000 ; LongTemp > 1; LongTemp /= 10)
+	else
 	{
-		while (LongAltitude >= LongTemp)	// Convert each order of 10 to a #
+		if (speed >= beacon.fast_speed)
+		{
+			rate = beacon.fast_rate;
+		}
+		else
 		{
-			LongAltitude -= LongTemp;		// By looping, sub'ing each time
-			count++;								// Keep track of iteration loops
+			rate = (unsigned long)beacon.fast_rate * beacon.fast_speed / speed;
 		}
-		Altifeet[index++] = count + 48;	// Save that count as a character
-		count = 0;								// Reset count and start over
+
+		turn = (course > beacon_course)? course - beacon_course
+													: beacon_course - course;
+		if (turn > 180) turn = 360 - turn;	// Shorter way round the compass
+		corner = (turn > beacon.turn_min + beacon.turn_slope / speed);
 	}
+	rate *= BAUD_RATE;							// Seconds to bit periods
 
-	Altifeet[index++] = LongAltitude + 48;	// Last digit resides in LongAlt...
-	Altifeet[index] = 0;						// Terminate string
-	return;
+	if (!beacon_started
+		|| (elapsed >= rate)
+		|| (corner
+			&& (elapsed >= (unsigned long)beacon.min_turn_time * BAUD_RATE)))
+	{
+		beacon_started = TRUE;
+		beacon_ticks += elapsed;
+		beacon_course = course;
+		return(TRUE);
+	}
 
-}		// End MsgPrepare(void)
+	return(FALSE);
+
+}		// End MsgBeaconDue(void)
 
 
 /******************************************************************************/
@@ -185,32 +433,54 @@ extern void MsgSendPos(void)
 * RETURN:	None
 */
 {
+#ifdef POS_MICE
+	MsgSendMicE();							// Longitude, speed, course, altitude
+	return;
+#endif
 	ax25sendByte('@');						// The "@" Symbol means time stamp first
-	ax25sendString(Time);					// Send the time
-	ax25sendByte('z');						// Tag it as zulu
-	Latitude[7] = 0;							// Truncate Latitude past 7th character
-	ax25sendString(Latitude);				// Send it
-	ax25sendByte('N');						// As degrees North
+	MsgSendTime();							// Send the time
+	ax25sendByte('h');						// Tag it as zulu HHMMSS
+#ifdef POS_COMPRESSED
+	MsgSendCompressed();					// Position, symbol and cs in 13 bytes
+#elif defined(GPS_UBX)
+	MsgSendMinutes(MsgHundredths(tx->Latitude), 6);	// DDMM.MM
+	ax25sendByte(FixSouth(tx)? 'S' : 'N');
 	ax25sendByte('/');						// Symbol Table Identifier
-	Longitude[8] = 0;							// Truncate Longitude past 8th character
-	ax25sendString(Longitude);				// Send it
-	ax25sendByte('W');						// As degrees West
+	MsgSendMinutes(MsgHundredths(tx->Longitude), 7);	// DDDMM.MM
+	ax25sendByte(FixWest(tx)? 'W' : 'E');
 	ax25sendByte('O');						// Symbol Code for a balloon icon
-	Course[3] = 0;								// Truncate course at 3 characters
-	ax25sendString(Course);					// Transmit Course
+#else
+	ax25sendString(tx->Latitude);			// Send it (parser kept 7 characters)
+	ax25sendByte(tx->NorthSouth[0]);		// As degrees North or South
+	ax25sendByte('/');						// Symbol Table Identifier
+	ax25sendString(tx->Longitude);		// Send it (parser kept 8 characters)
+	ax25sendByte(tx->EastWest[0]);		// As degrees East or West
+	ax25sendByte('O');						// Symbol Code for a balloon icon
+#endif
+#ifndef POS_COMPRESSED
+	NumFormat(num_buffer, course_degrees, 3);
+	ax25sendString(num_buffer);					// Transmit Course (3 characters)
 	ax25sendByte('/');						// Just a separator with no meaning
-	Speed[3] = 0;								// Truncate speed at 3 characters
-	ax25sendString(Speed);					// Transmit Speed
+	NumFormat(num_buffer, (speed_knots > 999)? 999 : speed_knots, 3);
+	ax25sendString(num_buffer);					// Transmit Speed (3 characters)
+#endif
 
 	// Begin Comment - up to 36 characters are permissable
+#if !(defined(POS_COMPRESSED) && defined(COMPRESSED_ALTITUDE))
 	ax25sendByte('/');						// A little more data...
 	ax25sendByte('A');						// ...to be interpreted as altitude...
 	ax25sendByte('=');						// ...starts right now
 	ax25sendString(Altifeet);				// Send Altitude in feet
 	ax25sendByte(' ');						// Space for formatting
+#endif
 	// Send number of Satellites tracked in HEX
-	if (Satellites[0] == '1') Satellites[1] += 17; // '0' becomes 'A'...
-	ax25sendByte(Satellites[1]);
+#ifdef GPS_UBX
+	ax25sendByte((tx->Satellites < 10)? tx->Satellites + '0'
+													: tx->Satellites + 'A' - 10);
+#else
+	ax25sendByte((tx->Satellites[0] == '1')? tx->Satellites[1] + 17 // 'A'...
+														: tx->Satellites[1]);
+#endif
 	ax25sendByte(' ');						// Space for formatting
 	//ax25sendASCIIebyte(ADCGet(0) + 7);	// Send analog channel 0
 	//ax25sendByte(' ');						// Space for formatting
@@ -220,6 +490,307 @@ extern void MsgSendPos(void)
 }		// End MsgSendPos(void)
 
 
+/******************************************************************************/
+static void MsgSendTime(void)
+/*******************************************************************************
+* ABSTRACT:	Sends the latched fix's UTC time as HHMMSS.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+#ifdef GPS_UBX
+	NumFormat(num_buffer, tx->Time[0] * 10000UL + tx->Time[1] * 100
+								+ tx->Time[2], 6);
+	ax25sendString(num_buffer);
+#else
+	ax25sendString(tx->Time);
+#endif
+	return;
+
+}		// End MsgSendTime(void)
+
+
+#ifdef GPS_UBX
+/******************************************************************************/
+static unsigned long MsgHundredths(signed long position)
+/*******************************************************************************
+* ABSTRACT:	Converts a NAV-PVT latitude or longitude into hundredths of a
+*				minute, truncated like the NMEA DDMM.MM fields. The sign
+*				(hemisphere) is dropped. Whole degrees and the fraction are
+*				scaled apart so nothing overflows 32 bits.
+*
+* INPUT:		position		Degrees times 10^7
+* OUTPUT:	None
+* RETURN:	The position in hundredths of a minute
+*/
+{
+	unsigned long	value;
+
+	value = (position < 0)? -position : position;
+	return((value / 10000000UL) * 6000 + (value % 10000000UL) * 6 / 10000);
+
+}		// End MsgHundredths(signed long position)
+
+
+#ifndef POS_COMPRESSED
+/******************************************************************************/
+static void MsgSendMinutes(unsigned long position, unsigned char width)
+/*******************************************************************************
+* ABSTRACT:	Sends a position in the uncompressed APRS form, DDMM.MM for
+*				latitude or DDDMM.MM for longitude.
+*
+* INPUT:		position		Hundredths of a minute
+*				width			Digits to send, 6 or 7
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	unsigned char	loop;
+
+	NumFormat(num_buffer, (position / 6000) * 10000 + position % 6000, width);
+	for (loop = 0 ; loop < width ; loop++)
+	{
+		if (loop == width - 2) ax25sendByte('.');
+		ax25sendByte(num_buffer[loop]);
+	}
+	return;
+
+}		// End MsgSendMinutes(unsigned long position, unsigned char width)
+#endif
+
+#elif defined(POS_COMPRESSED) || defined(POS_MICE)
+/******************************************************************************/
+static unsigned long MsgHundredths(unsigned char *string)
+/*******************************************************************************
+* ABSTRACT:	Converts a DDMM.MM or DDDMM.MM position into hundredths of a
+*				minute. Missing trailing digits count as zero.
+*
+* INPUT:		*string			Pointer to the position field
+* OUTPUT:	None
+* RETURN:	The position in hundredths of a minute
+*/
+{
+	unsigned long	value;			// DDDMMhh as one number
+
+	value = NumParse(string, 2);
+	return((value / 10000) * 6000 + (value % 10000));
+
+}		// End MsgHundredths(unsigned char *string)
+#endif
+
+
+#if defined(POS_COMPRESSED) || defined(POS_MICE)
+
+/******************************************************************************/
+static void MsgSendBase91(unsigned long value, unsigned char digits)
+/*******************************************************************************
+* ABSTRACT:	Sends a number as base-91 characters, most significant first,
+*				each digit offset by 33 as the APRS compressed format requires.
+*
+* INPUT:		value		The number to send
+*				digits	How many base-91 digits to send (up to 4)
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	unsigned char	loop;
+
+	for (loop = digits ; loop ; )
+	{
+		num_buffer[--loop] = (value % 91) + 33;
+		value /= 91;
+	}
+
+	for (loop = 0 ; loop < digits ; loop++)
+	{
+		ax25sendByte(num_buffer[loop]);
+	}
+
+	return;
+
+}		// End MsgSendBase91(unsigned long value, unsigned char digits)
+#endif
+
+
+#ifdef POS_COMPRESSED
+/******************************************************************************/
+static void MsgSendCompressed(void)
+/*******************************************************************************
+* ABSTRACT:	Sends the 13 byte compressed position: symbol table, YYYY
+*				latitude, XXXX longitude, symbol code, the cs bytes and the
+*				compression type byte. Integer arithmetic only:
+*					YYYY = 380926 * (90 - latitude)
+*					XXXX = 190463 * (180 + longitude)
+*				with each position split into whole degrees and hundredths
+*				of a minute so no product overflows 32 bits.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	unsigned long	position;		// Hundredths of a minute
+	unsigned long	offset;			// Scaled distance from the equator
+	unsigned short	cs;				// Course/speed or altitude value
+#ifdef COMPRESSED_ALTITUDE
+	unsigned long	value;			// Altitude normalized for log2
+	short			log2;				// log2(altitude) in 8.8 fixed point
+	unsigned char	bit;				// Fraction bit being resolved
+#else
+	unsigned long	power;			// 1.08^cs in 24.8 fixed point
+	unsigned long	target;			// speed + 1 in 24.8 fixed point
+#endif
+
+	ax25sendByte('/');						// Symbol Table Identifier
+
+	// North and West subtract, so their offsets round up to keep the
+	// result truncated toward the equator and the prime meridian.
+	position = MsgHundredths(tx->Latitude);	// Hundredths of a minute, unsigned
+	offset = (position % 6000) * 380926UL + (FixSouth(tx)? 0 : 5999);
+	offset = (position / 6000) * 380926UL + offset / 6000;
+	MsgSendBase91(FixSouth(tx)? 34283340UL + offset
+														 : 34283340UL - offset, 4);
+
+	position = MsgHundredths(tx->Longitude);
+	offset = (position % 6000) * 190463UL + (FixWest(tx)? 5999 : 0);
+	offset = (position / 6000) * 190463UL + offset / 6000;
+	MsgSendBase91(FixWest(tx)? 34283340UL - offset
+													  : 34283340UL + offset, 4);
+
+	ax25sendByte('O');						// Symbol Code for a balloon icon
+
+#ifdef COMPRESSED_ALTITUDE
+	// cs = log(feet) / log(1.002) = log2(feet) * 346.92
+	cs = 0;
+	if (altitude_feet > 1)
+	{
+		value = altitude_feet;
+		log2 = 15 * 256;						// value is scaled to 1.15 fixed point
+		while (value >= 0x10000UL) { value >>= 1; log2 += 256; }
+		while (value < 0x8000UL) { value <<= 1; log2 -= 256; }
+		for (bit = 128 ; bit ; bit >>= 1)	// Square to find each fraction bit
+		{
+			value = (value * value) >> 15;
+			if (value >= 0x10000UL)
+			{
+				value >>= 1;
+				log2 += bit;
+			}
+		}
+		cs = ((unsigned long)log2 * 34692UL) / 25600UL;
+		if (cs > 91 * 91 - 1) cs = 91 * 91 - 1;
+	}
+	MsgSendBase91(cs, 2);
+	ax25sendByte(0x32 + 33);				// Current fix, GGA altitude, software
+#else
+	ax25sendByte(course_degrees / 4 + 33);	// Course in 4 degree steps
+
+	// Speed is 1.08^s - 1 knots, so find the largest s that fits
+	cs = 0;
+	power = 256;
+	target = ((unsigned long)speed_knots + 1) << 8;
+	while ((cs < 89) && (power + (power * 2) / 25 <= target))
+	{
+		power += (power * 2) / 25;			// Multiply by 1.08
+		cs++;
+	}
+	ax25sendByte(cs + 33);
+	ax25sendByte(0x3A + 33);				// Current fix, RMC course/speed, software
+#endif
+	return;
+
+}		// End MsgSendCompressed(void)
+#endif
+
+
+#ifdef POS_MICE
+/******************************************************************************/
+static void MsgMicEDestination(void)
+/*******************************************************************************
+* ABSTRACT:	Builds the Mic-E destination address from the latched fix and
+*				hands it to the AX.25 header. Each of the six latitude digits
+*				DDMMhh becomes '0'-'9', or 'P'-'Y' when its flag bit is set:
+*				three message bits, North, longitude offset +100, and West.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	unsigned long	position;		// Latitude in hundredths of a minute
+	unsigned short	degrees;			// Whole degrees of longitude
+	unsigned char	flags;			// One bit per destination character
+	unsigned char	loop;
+
+	position = MsgHundredths(tx->Latitude);
+	NumFormat(num_buffer, (position / 6000) * 10000 + position % 6000, 6);
+
+	degrees = MsgHundredths(tx->Longitude) / 6000;
+	flags = MICE_MESSAGE << 3;				// Message bits in characters 1-3
+	if (!FixSouth(tx)) flags |= 1<<2;
+	if ((degrees < 10) || (degrees >= 100)) flags |= 1<<1;
+	if (FixWest(tx)) flags |= 1<<0;
+
+	for (loop = 0 ; loop < 6 ; loop++)
+	{
+		mice_dest[loop] = (num_buffer[loop] + ((flags & (0x20 >> loop))? 'P' - '0' : 0)) << 1;
+	}
+	mice_dest[6] = 0x60;						// SSID 0, no digipeat path
+
+	ax25setDestination(mice_dest);
+	return;
+
+}		// End MsgMicEDestination(void)
+
+
+/******************************************************************************/
+static void MsgSendMicE(void)
+/*******************************************************************************
+* ABSTRACT:	Sends the Mic-E information field: longitude degrees, minutes
+*				and hundredths, speed and course packed into three bytes, the
+*				symbol, and altitude as three base-91 digits of meters + 10000.
+*				Every value is offset by 28 as the format requires.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	unsigned long	position;		// Longitude in hundredths of a minute
+	unsigned short	value;			// Degrees, then minutes
+
+	ax25sendByte('`');						// Current Mic-E data
+
+	position = MsgHundredths(tx->Longitude);
+	value = position / 6000;
+	if (value < 10) value += 90;			// 0-9 degrees use the +100 offset
+	else if (value >= 110) value -= 100;
+	else if (value >= 100) value -= 20;	// 100-109 land on 180-189
+	ax25sendByte(value + 28);
+
+	value = (position % 6000) / 100;		// Minutes
+	if (value < 10) value += 60;
+	ax25sendByte(value + 28);
+	ax25sendByte((position % 100) + 28);	// Hundredths of a minute
+
+	value = speed_knots / 10;				// Tens of knots
+	ax25sendByte(((value < 20)? value + 80 : value) + 28);
+	ax25sendByte((speed_knots % 10) * 10 + course_degrees / 100 + 28);
+	ax25sendByte((course_degrees % 100) + 28);
+
+	ax25sendByte('O');						// Symbol Code for a balloon icon
+	ax25sendByte('/');						// Symbol Table Identifier
+
+	MsgSendBase91(altitude_meters + 10000, 3);	// Meters above -10 km
+	ax25sendByte('}');
+	return;
+
+}		// End MsgSendMicE(void)
+#endif
+
+
 /******************************************************************************/
 extern void MsgSendTelem(void)
 /*******************************************************************************
@@ -231,7 +802,7 @@ extern void MsgSendTelem(void)
 */
 {
 	static unsigned char	sequence;		// Telemetry sequence number
-	static unsigned char	temp;				// To loop analog / digital channels
+	unsigned char	temp;				// To loop analog / digital channels
 
 	ax25sendByte('T');						// Data type identifier for telemetry
 	ax25sendByte('#');						// "#" for sequence number
@@ -258,105 +829,289 @@ extern void MsgSendTelem(void)
 	ax25sendByte(',');						// Another comma so that I can...
 	ax25sendASCIIebyte(ADCGet(0));		// Send analog channel 0 in ASCII
 	ax25sendByte(',');						// Another comma so that I can...
-	ax25sendString(Time);					// Send the time
+	MsgSendTime();							// Send the time
 	return;
 
 }		// End MsgSendTelem(void)
 
 
+#ifdef GPS_UBX
+/******************************************************************************/
+extern void MsgHandler(unsigned char newchar)
+/*******************************************************************************
+* ABSTRACT:	Processes the bytes coming in from USART.  In this case,
+*				this is the port connected to the gps receiver, sending
+*				UBX NAV-PVT. Anything else is skipped until the next sync.
+*				Payload bytes named in ubx_fields are copied straight into
+*				the fix as they arrive, so each byte costs a few compares.
+*				The fix is only published once the Fletcher checksum
+*				matches and the receiver says the solution is good.
+*
+* INPUT:		newchar	Next byte from the serial port.
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	static unsigned char	state;			// One of the UBX_ parser states
+	static unsigned char	index;			// Header or payload bytes so far
+	static unsigned char	ck_a;				// Fletcher sums over class through
+	static unsigned char	ck_b;				// the end of the payload
+	static unsigned char	fix_ok;			// Fix type and flags are good
+	static unsigned char	next;				// Next entry in ubx_fields
+	static unsigned char	*field;			// Field being copied, or 0
+	static unsigned char	field_left;		// Bytes of it still to come
+
+	switch (state)
+	{
+		case (UBX_SKIP):
+			if (newchar == 0xB5) state = UBX_SYNC;
+			return;
+
+		case (UBX_SYNC):
+			if (newchar != 0x62)
+			{
+				state = (newchar == 0xB5)? UBX_SYNC : UBX_SKIP;
+				return;
+			}
+			state = UBX_HEADER;
+			index = 0;
+			ck_a = ck_b = 0;
+			return;
+
+		case (UBX_HEADER):
+			ck_a += newchar;
+			ck_b += ck_a;
+			if (newchar != pgm_read_byte(&ubx_header[index]))
+			{
+				state = UBX_SKIP;				// Not NAV-PVT, or a length we
+				return;							// don't understand
+			}
+			if (++index == sizeof(ubx_header))
+			{
+				state = UBX_DATA;
+				index = 0;
+				next = 0;
+				field = 0;
+				fix_ok = TRUE;
+			}
+			return;
+
+		case (UBX_DATA):
+			ck_a += newchar;
+			ck_b += ck_a;
+
+			if ((next < sizeof(ubx_fields) / 3) &&
+				 (index == pgm_read_byte(&ubx_fields[next][0])))
+			{
+				field = (unsigned char *)&fix[back]
+						+ pgm_read_byte(&ubx_fields[next][1]);
+				field_left = pgm_read_byte(&ubx_fields[next][2]);
+				next++;
+			}
+
+			if (field)
+			{
+				*field++ = newchar;
+				if (--field_left == 0) field = 0;
+			}
+
+			// fixType 2D, 3D or GNSS + dead reckoning, and gnssFixOK set
+			if (((index == 20) && ((newchar < 2) || (newchar > 4))) ||
+				 ((index == 21) && !(newchar & 0x01)))
+			{
+				fix_ok = FALSE;
+			}
+
+			if (++index == UBX_PVT_LEN) state = UBX_CK_A;
+			return;
+
+		case (UBX_CK_A):
+			if (newchar != ck_a) fix_ok = FALSE;
+			state = UBX_CK_B;
+			return;
+
+		case (UBX_CK_B):
+			state = UBX_SKIP;
+			if ((newchar == ck_b) && fix_ok && !fix_lock)
+			{
+				back ^= 1;						// Publish it, parse into the other
+			}
+			return;
+	}
+
+	return;
+
+}		// End MsgHandler(unsigned char newchar)
+
+#else
 /******************************************************************************/
 extern void MsgHandler(unsigned char newchar)
 /*******************************************************************************
 * ABSTRACT:	Processes the characters coming in from USART.  In this case,
 *				this is the port connected to the gps receiver.
+*				The sentence ID is looked up in nmea_ids and each comma looks
+*				up its field in nmea_fields; everything else is skipped until
+*				the next '$'. Fields are bounded to their size in the fix, and
+*				a sentence only counts toward publishing the fix once its *hh
+*				checksum matches; one cut short or failing it withdraws its
+*				type from the pair. The UTC time digits are packed four bits
+*				apiece, so a GPGGA and GPRMC pair only when their times agree.
 *
 * INPUT:		newchar	Next character from the serial port.
 * OUTPUT:	None
 * RETURN:	None
 */
 {
+	static unsigned char	state;			// One of the NMEA_ parser states
 	static unsigned char	commas;			// Number of commas for far in sentence
 	static unsigned char	index;			// Individual array index
-
-	if (newchar == 0)							// A NULL character resets GPS decoding
-	{
-		commas = 25;							// Set to an outrageous value
-		sentence_type = FALSE;				// Clear local parse variable
-		return;
-	}
+	static unsigned char	checksum;		// XOR of everything between $ and *
+	static unsigned char	sentence_ok;	// Fix status in the sentence is valid
+	static unsigned char	id[3];			// Sentence ID with the talker stripped
+	static unsigned char	*field;			// Field being parsed, or 0 to skip
+	static unsigned char	field_size;		// Room in field including terminator
+	static unsigned long	sentence_time;	// UTC digits of this sentence
+	unsigned char	loop;				// For searching the tables
 
 	if (newchar == '$')						// Start of Sentence character, reset
 	{
+		if (state != NMEA_SKIP)				// The last one was cut short, so
+		{
+			fix_seen &= ~sentence_type;		// its fields may be half written
+		}
+		state = NMEA_ID;
 		commas = 0;								// No commas detected in sentence for far
+		index = 0;
+		checksum = 0;
 		sentence_type = FALSE;				// Clear local parse variable
+		sentence_ok = TRUE;					// Until the status field says otherwise
+		sentence_time = 0;
 		return;
 	}
 
-	if (newchar == ',')						// If there is a comma
-	{
-		commas += 1;							// Increment the comma count
-		index = 0;								// And reset the field index
-		return;
-	}
-
-	if (commas == 0)
+	switch (state)
 	{
-		switch(newchar)
-		{
-			case ('C'):							// Only the GPRMC sentence contains a "C"
-				sentence_type = GPRMC;		// Set local parse variable
-				break;
-			case ('S'):							// Take note if sentence contains an "S"
-				sentence_type = 'S';			// ...because we don't want to parse it
-				break;
-			case ('A'):							// The GPGGA sentence ID contains "A"
-				if (sentence_type != 'S')	// As does GPGSA, which we will ignore
-					sentence_type = GPGGA;	// Set local parse variable
-				break;
-		}
+		case (NMEA_ID):
+			if (newchar != ',')
+			{
+				checksum ^= newchar;
+				if (index >= 5)				// Too long for a standard ID
+				{
+					state = NMEA_SKIP;
+				}
+				else if (index++ >= 2)		// Skip the two talker characters
+				{
+					id[index - 3] = newchar;
+				}
+				return;
+			}
 
-		return;
-	}
+			for (loop = 0 ; (index == 5) && (loop < 2) ; loop++)
+			{
+				if ((id[0] == pgm_read_byte(&nmea_ids[loop][0])) &&
+					 (id[1] == pgm_read_byte(&nmea_ids[loop][1])) &&
+					 (id[2] == pgm_read_byte(&nmea_ids[loop][2])))
+				{
+					sentence_type = loop + 1;	// GPRMC or GPGGA
+				}
+			}
 
-	if (sentence_type == GPGGA)			// GPGGA sentence	decode initiated
-	{
-		switch (commas)
-		{
-			case (1):									// Time field, grab characters
-				Time_Temp[index++] = newchar;
-				return;
-			case (2):									// Latitude field, grab chars
-				Latitude_Temp[index++] = newchar;
-				return;
-			case (4):									// Longitude field, grab chars
-				Longitude_Temp[index++] = newchar;
+			if (!sentence_type)				// Not one we want, skip it cheaply
+			{
+				state = NMEA_SKIP;
 				return;
-			case (7):									// Satellite field, grab chars
-				Satellites_Temp[index++] = newchar;
+			}
+
+			state = NMEA_DATA;
+			/* Fall through, the comma starts the first field */
+
+		case (NMEA_DATA):
+			if (newchar == '*')				// End of the sentence data
+			{
+				state = NMEA_SUM_HI;
 				return;
-			case (9):									// Altitude field, grab chars
-				Altitude_Temp[index++] = newchar;
+			}
+
+			if (newchar < ' ')				// Line ended without a checksum
+			{
+				fix_seen &= ~sentence_type;	// Its fields may be half written
+				state = NMEA_SKIP;
 				return;
-		}
+			}
 
-		return;
-	}		// end if (sentence_type == GPGGA)
+			checksum ^= newchar;
 
-	if (sentence_type == GPRMC)			// GPGGA sentence	decode initiated
-	{
-		switch (commas)
-		{
-			case (7):									// Speed field, grab characters
-				Speed_Temp[index++] = newchar;
+			if (newchar == ',')				// If there is a comma
+			{
+				commas += 1;					// Increment the comma count
+				index = 0;						// And reset the field index
+				field = 0;
+				for (loop = 0 ; loop < sizeof(nmea_fields) / 4 ; loop++)
+				{
+					if ((pgm_read_byte(&nmea_fields[loop][0]) == sentence_type) &&
+						 (pgm_read_byte(&nmea_fields[loop][1]) == commas))
+					{
+						field = (unsigned char *)&fix[back]
+								+ pgm_read_byte(&nmea_fields[loop][2]);
+						field_size = pgm_read_byte(&nmea_fields[loop][3]);
+						field[0] = 0;			// An empty field leaves no stale data
+					}
+				}
 				return;
-			case (8):									// Course field, grab characters
-				Course_Temp[index++] = newchar;
+			}
+
+			// Check the fix status: GPGGA quality 0 or GPRMC status 'V' is no fix
+			if (((sentence_type == GPGGA) && (commas == 6) && (newchar == '0')) ||
+				 ((sentence_type == GPRMC) && (commas == 2) && (newchar != 'A')))
+			{
+				sentence_ok = FALSE;
+			}
+
+			if ((commas == 1) && (newchar >= '0') && (newchar <= '9'))
+			{										// Both sentences lead with the time
+				sentence_time = (sentence_time << 4) | (newchar - '0');
+			}
+
+			if (field && (index < field_size - 1))	// Grab characters that fit
+			{
+				field[index++] = newchar;
+				field[index] = 0;				// Keep the field terminated
+			}
+			return;
+
+		case (NMEA_SUM_HI):
+			checksum ^= (newchar - ((newchar > '9')? 'A' - 10 : '0')) << 4;
+			state = NMEA_SUM_LO;
+			return;
+
+		case (NMEA_SUM_LO):
+			checksum ^= newchar - ((newchar > '9')? 'A' - 10 : '0');
+			state = NMEA_SKIP;
+
+			if (checksum || !sentence_ok)	// Corrupt, or no fix in it
+			{
+				fix_seen &= ~sentence_type;
 				return;
-		}
+			}
 
-		return;
-	}		// end if (sentence_type == GPRMC)
+			if (fix_seen && (sentence_time != fix_time))
+			{
+				fix_seen = 0;					// The other half is from another epoch
+			}
+			fix_time = sentence_time;
+			fix_seen |= sentence_type;
+			if (fix_seen == GPBOTH)			// Both halves of the fix are in
+			{
+				if (!fix_lock)					// Drop it if the front is in use
+				{
+					back ^= 1;					// Publish it, parse into the other
+				}
+				fix_seen = 0;
+			}
+			return;
+	}
 
 	return;
 
 }		// End MsgHandler(unsigned char newchar)
+#endif
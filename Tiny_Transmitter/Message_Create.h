@@ -9,11 +9,55 @@
  * Version		1.5
  */ 
 
+// Uncomment to send positions in the 13 byte base-91 compressed format
+// instead of the uncompressed DDMM.MMN/DDDMM.MMW form.
+//#define	POS_COMPRESSED
+
+// With POS_COMPRESSED, uncomment to carry altitude in the compressed cs
+// bytes (dropping course/speed) instead of a /A=ffffff comment.
+//#define	COMPRESSED_ALTITUDE
+
+// Uncomment to send Mic-E position beacons instead: latitude rides in the
+// AX.25 destination address and the info field shrinks to about 14 bytes.
+//#define	POS_MICE
+
+#define	MICE_MESSAGE (6)					// Mic-E message bits ABC, 110 = En Route
+
+// Uncomment to read the u-blox UBX NAV-PVT message (u-blox 8 or later)
+// instead of NMEA GGA and RMC. One 100 byte binary message per epoch
+// carries the whole fix, so there is no text to scan, and the formatters
+// work from binary values. MsgConfigure() sends CFG-MSG to turn on NAV-PVT
+// once per solution, then CFG-PRT for UBX out only at 4800 baud. It is
+// sent at every boot rather than saved in the receiver, and it is sent at
+// 4800 baud, so the receiver's port must already be listening at 4800.
+// Most u-blox modules default to 9600: save 4800 in the module once first.
+//#define	GPS_UBX
+
+// SmartBeaconing parameters, stored in EEPROM at EE_BEACON. Leave the first
+// byte at 0xFF to use the built-in defaults.
+#define	EE_BEACON (0xE0)
+
+struct BeaconConfig
+{
+	unsigned char	fast_speed;			// Knots at and above which fast_rate applies
+	unsigned short	fast_rate;			// Seconds between beacons when fast
+	unsigned char	slow_speed;			// Knots at and below which slow_rate applies
+	unsigned short	slow_rate;			// Seconds between beacons when slow
+	unsigned short	min_turn_time;		// Seconds, least time between corner pegs
+	unsigned char	turn_min;			// Degrees, least course change to peg
+	unsigned char	turn_slope;			// Degrees times knots, added at low speed
+};
 
-unsigned char	Time_Temp[7]; 	// Temp variable here so main can read seconds
 
 extern void MsgInit (void);
+#ifdef GPS_UBX
+extern void MsgConfigure (void);
+#else
+#define	MsgConfigure()						// NMEA is the receiver's default
+#endif
 extern void MsgPrepare (void);
+extern void MsgRelease (void);
+extern unsigned char MsgBeaconDue (void);
 extern void MsgSendPos (void);
 extern void MsgSendTelem (void);
 extern void MsgSendAck (unsigned char *rxbytes, unsigned char msg_start);
@@ -0,0 +1,165 @@
+/*******************************************************************************
+File:			Number.c
+
+ 				Decimal parse, format and unit conversion function library.
+				Every decimal number that goes on air or out the serial port
+				passes through here.
+
+Functions:	extern unsigned long NumParse (unsigned char *string,
+												unsigned char decimals)
+				extern unsigned char NumFormat (char *buffer,
+								unsigned long value, unsigned char width)
+				extern unsigned long NumMetersToFeet (unsigned long decimeters)
+				extern unsigned short NumRound (unsigned char *string)
+
+Revisions:	1.00	10/17/26	Replaces the repeated subtraction converters
+
+Copyright:		(c)2014, Justin D. Owen (justin.owen2@tulsacc.edu). All rights reserved.
+				This software is available only for non-commercial amateur radio
+				or educational applications.  All other uses are prohibited.
+				This software may be modified only if the resulting code be
+				made available publicly and the original author(s) given credit.
+
+*******************************************************************************/
+
+// OS headers
+#include <avr/pgmspace.h>
+
+// General purpose include files
+#include "Std_Defines.h"
+
+// App required include files
+#include "Number.h"
+
+char				num_buffer[NUM_DIGITS + 1];	// Shared formatting scratch
+
+// Powers of ten, used only to count the digits NumFormat has to emit
+static const unsigned long num_powers[NUM_DIGITS] PROGMEM = {
+	1UL, 10UL, 100UL, 1000UL, 10000UL, 100000UL, 1000000UL,
+	10000000UL, 100000000UL, 1000000000UL};
+
+
+/******************************************************************************/
+extern unsigned long NumParse(unsigned char *string, unsigned char decimals)
+/*******************************************************************************
+* ABSTRACT:	Converts a decimal string such as "1234.5" into a fixed point
+*				number with the given count of decimal places, so "1234.5"
+*				with 2 decimals is 123450. Missing decimal digits count as
+*				zero and extra ones are dropped. Parsing stops at the first
+*				character that is not a digit, so a field with a sign or
+*				nothing in it reads as zero.
+*
+* INPUT:		*string		Pointer to the digits
+*				decimals		Decimal places to keep
+* OUTPUT:	None
+* RETURN:	The value times 10 to the power decimals
+*/
+{
+	unsigned long	value;
+
+	value = 0;
+	while ((*string >= '0') && (*string <= '9'))
+	{
+		value = value * 10 + (*string++ - '0');
+	}
+
+	if (*string == '.') string++;			// Step over the decimal point
+	while (decimals--)
+	{
+		value *= 10;
+		if ((*string >= '0') && (*string <= '9'))
+		{
+			value += *string++ - '0';
+		}
+	}
+
+	return(value);
+
+}		// End NumParse(unsigned char *string, unsigned char decimals)
+
+
+/******************************************************************************/
+extern unsigned char NumFormat(char *buffer, unsigned long value,
+												unsigned char width)
+/*******************************************************************************
+* ABSTRACT:	Writes value into buffer as a null-terminated decimal string,
+*				padded with leading zeros to at least width digits. Each digit
+*				costs the same few shifts and adds: the divide by ten is the
+*				shift-add reciprocal from Hacker's Delight, so there is no
+*				library division and no subtraction loop.
+*
+* INPUT:		*buffer		Room for NUM_DIGITS + 1 bytes, or width + 1 if
+*							the value is known to fit
+*				value			Number to convert
+*				width			Least number of digits, 0 for no padding
+* OUTPUT:	*buffer		The digits
+* RETURN:	The number of digits written
+*/
+{
+	unsigned long	quotient;
+	unsigned char	count;			// Digits in the result
+	unsigned char	index;
+
+	count = 1;
+	while ((count < NUM_DIGITS)
+		&& (value >= pgm_read_dword(&num_powers[count])))
+	{
+		count++;
+	}
+	if (count < width) count = width;
+
+	buffer[count] = 0;						// Terminate string
+	for (index = count ; index ; )
+	{
+		quotient = (value >> 1) + (value >> 2);	// value * 0.75...
+		quotient += quotient >> 4;				// ...refined toward 0.8
+		quotient += quotient >> 8;
+		quotient += quotient >> 16;
+		quotient >>= 3;								// value / 10, maybe 1 low
+		value -= ((quotient << 2) + quotient) << 1;
+		if (value > 9)								// Correct the estimate
+		{
+			value -= 10;
+			quotient++;
+		}
+		buffer[--index] = value + '0';		// Fill right to left
+		value = quotient;
+	}
+
+	return(count);
+
+}		// End NumFormat(unsigned char *buffer, unsigned long value, ...)
+
+
+/******************************************************************************/
+extern unsigned long NumMetersToFeet(unsigned long decimeters)
+/*******************************************************************************
+* ABSTRACT:	Converts an altitude to feet, rounded to the nearest foot.
+*				A foot is exactly 0.3048 m, so feet = dm * 125 / 381. Good up
+*				to 3,400 km, well past anything a GPS will report.
+*
+* INPUT:		decimeters	Altitude in tenths of a meter
+* OUTPUT:	None
+* RETURN:	Altitude in feet
+*/
+{
+	return((decimeters * 125 + 190) / 381);
+
+}		// End NumMetersToFeet(unsigned long decimeters)
+
+
+/******************************************************************************/
+extern unsigned short NumRound(unsigned char *string)
+/*******************************************************************************
+* ABSTRACT:	Reads a decimal field such as NMEA speed in knots or course in
+*				degrees ("0.52", "022.4", "359.9") as a whole number, rounded
+*				to nearest.
+*
+* INPUT:		*string		Pointer to the digits
+* OUTPUT:	None
+* RETURN:	The rounded value
+*/
+{
+	return((NumParse(string, 1) + 5) / 10);
+
+}		// End NumRound(unsigned char *string)
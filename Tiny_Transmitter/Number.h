@@ -0,0 +1,22 @@
+/*******************************************************************************
+File:			Number.h
+
+ 				Decimal conversion module definitions/declarations.
+
+Version:		1.05
+
+*******************************************************************************/
+
+#define	NUM_DIGITS (10)						// Digits in the largest unsigned long
+
+// Scratch for formatting digits, shared by every formatter that runs from
+// the main loop: serial reports, telemetry and the position encoders. They
+// never nest, so one buffer serves them all. Not for use in an ISR.
+extern char	num_buffer[NUM_DIGITS + 1];
+
+// external function prototypes
+extern unsigned long NumParse(unsigned char *string, unsigned char decimals);
+extern unsigned char NumFormat(char *buffer, unsigned long value,
+												unsigned char width);
+extern unsigned long NumMetersToFeet(unsigned long decimeters);
+extern unsigned short NumRound(unsigned char *string);
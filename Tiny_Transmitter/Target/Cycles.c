@@ -0,0 +1,568 @@
+/*******************************************************************************
+File:			Cycles.c
+
+				Runs the ATtiny4313 build under simavr and checks it against
+				cycle budgets. The firmware is built with ISR_PROFILE, so each
+				ISR writes its PROFILE_ id to GPIOR0 on entry and 0 on exit.
+				An NMEA log plays into the UART at 4800 baud, back to back,
+				for the whole run, and the firmware beacons from it.
+
+				For each ISR it reports the calls, the worst and mean cycles
+				between the markers, and the worst latency from the interrupt
+				flag rising to the ProfileEnter() write, which takes in the
+				response, the prologue and any ISR already running. Then
+				the share of the CPU not asleep while the PTT is keyed. Any
+				figure over its budget fails the run, and so does an ISR
+				with a budget that never ran, or a key-up without the tone
+				ISR. The worst UART receive is reported with the sentence
+				being received.
+
+				Usage: Cycles firmware.elf log.nmea [name=value ...]
+				Budgets: tone, baud, uart_rx, uart_tx and rx for worst ISR
+				cycles, tone_latency for the worst tone ISR latency keyed up,
+				cpu for percent busy keyed up. keyups=n ends the run after n
+				key-ups, seconds=n after n simulated seconds at the most.
+				margin=n prints a BUDGETS line for the Makefile instead of
+				checking: each figure measured, plus n percent.
+
+Functions:	extern int main(int argc, char **argv)
+				static void CyclesMarker(avr_t *avr, avr_io_addr_t address,
+											uint8_t value, void *param)
+				static void CyclesPending(avr_irq_t *irq, uint32_t value,
+											void *param)
+				static void CyclesKey(avr_irq_t *irq, uint32_t value,
+											void *param)
+				static void CyclesSerial(avr_irq_t *irq, uint32_t value,
+											void *param)
+				static avr_cycle_count_t CyclesFeed(avr_t *avr,
+											avr_cycle_count_t when, void *param)
+				static unsigned long *CyclesBudget(const char *name)
+				static unsigned char CyclesOver(const char *name,
+											unsigned long value)
+				static unsigned long CyclesMargin(unsigned long value)
+
+*******************************************************************************/
+
+// OS headers
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// simavr headers
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_io.h"
+#include "sim_irq.h"
+#include "sim_interrupts.h"
+#include "sim_cycle_timers.h"
+#include "avr_eeprom.h"
+#include "avr_ioport.h"
+#include "avr_uart.h"
+
+#define	F_CPU (14745600UL)					// As Tiny_Transmitter.h
+#define	GPIOR0_ADDR (0x33)					// GPIOR0, I/O 0x13, in data space
+#define	VECTORS (21)							// ATtiny4313 vectors, reset included
+#define	BYTE_CYCLES (F_CPU * 10 / 4800)	// One 8N1 byte at 4800 baud
+#define	PROFILE_IDS (6)						// PROFILE_ ids are 1 to 5
+#define	PROFILE_TONE (1)
+#define	PROFILE_UART_RX (3)
+#define	NESTING (4)							// Markers open at once, at most
+
+// PTT on PORTB: bit 0 when PB1 is the comparator input, as in
+// Tiny_Transmitter.c. Build the firmware and this with the same OPTIONS.
+#if defined(ANALOG_SAMPLING) || defined(AFSK_RECEIVE)
+#define	PTT_PIN (0)
+#else
+#define	PTT_PIN (1)
+#endif
+
+// The EEPROM as Host.c programs it: the header at ax25.c's HEADER_ADDR and
+// the status text at STATUS_ADDR. Every other setting reads its default.
+#define	HEADER_ADDR (31)
+#define	STATUS_ADDR (48)
+static const unsigned char	eeprom_header[] = {
+	0x82, 0xA0, 0x82, 0xAC, 0xA4, 0x60, 0x60,		// APAVR0-0
+	0x9C, 0x68, 0xA8, 0xB0, 0x92, 0x40, 0x77,		// N4TXI-11, last address
+	0x03, 0xF0, 0x00};									// Control, PID, end
+static const char	eeprom_status[] = ">See garydion.com";
+
+// Report names for the PROFILE_ ids in Tiny_Transmitter.h, and budgets
+static const char	*profile_name[PROFILE_IDS] = {
+	"", "tone", "baud", "uart_rx", "uart_tx", "rx"};
+
+typedef struct
+{
+	const char		*name;
+	unsigned long	limit;					// 0 for no budget
+} budget_t;
+
+static budget_t	budget[] = {
+	{"tone", 0}, {"baud", 0}, {"uart_rx", 0}, {"uart_tx", 0}, {"rx", 0},
+	{"tone_latency", 0}, {"cpu", 0}, {"keyups", 3}, {"seconds", 600},
+	{"margin", 0}};
+
+// Static functions
+static void CyclesMarker(avr_t *avr, avr_io_addr_t address, uint8_t value,
+																void *param);
+static void CyclesPending(avr_irq_t *irq, uint32_t value, void *param);
+static void CyclesKey(avr_irq_t *irq, uint32_t value, void *param);
+static void CyclesSerial(avr_irq_t *irq, uint32_t value, void *param);
+static avr_cycle_count_t CyclesFeed(avr_t *avr, avr_cycle_count_t when,
+																void *param);
+static unsigned long *CyclesBudget(const char *name);
+static unsigned char CyclesOver(const char *name, unsigned long value);
+static unsigned long CyclesMargin(unsigned long value);
+
+static avr_t	*avr;
+static FILE		*nmea;								// Played into the UART
+static avr_irq_t	*uart_input;
+
+static avr_cycle_count_t	raised[VECTORS];	// When each flag last rose
+static avr_cycle_count_t	serviced;			// Raise time of the vector now running
+
+static unsigned char	open_id[NESTING];		// Markers entered, not yet exited
+static avr_cycle_count_t	open_cycle[NESTING];
+static unsigned char	open_count;
+
+static unsigned long	calls[PROFILE_IDS];
+static unsigned long	worst[PROFILE_IDS];
+static unsigned long long	total[PROFILE_IDS];
+static unsigned long	latency[PROFILE_IDS];
+static unsigned long	tone_keyed;				// Worst tone latency while keyed
+
+static unsigned char	keyed;
+static avr_cycle_count_t	key_cycle;			// When the PTT went on
+static avr_cycle_count_t	key_sleep;			// sleep_cycles then
+static avr_cycle_count_t	keyed_cycles;		// Keyed, over every key-up
+static avr_cycle_count_t	keyed_sleep;		// Asleep while keyed
+static avr_cycle_count_t	sleep_cycles;		// Asleep, since reset
+static unsigned long	keyups;
+
+static char	line[96];								// Serial output line so far
+static unsigned char	line_length;
+static char	stack_report[96];					// Last $PTMEM line
+
+static char	sentence[96];							// Log line being played in
+static unsigned char	sentence_length;
+static char	rx_worst[96];							// It, at the worst UART receive
+
+static unsigned long	failures;
+
+
+/******************************************************************************/
+extern int main(int argc, char **argv)
+/*******************************************************************************
+* ABSTRACT:	Loads the firmware, hooks the markers, interrupt flags, PTT and
+*				UART, and runs it until enough key-ups are done. Then prints
+*				the report and checks the budgets.
+*
+* INPUT:		argv[1]	Firmware ELF, built with ISR_PROFILE
+*				argv[2]	NMEA log
+*				argv[3...]	name=value budgets and limits
+* OUTPUT:	None
+* RETURN:	0 if every figure is within budget, 1 otherwise
+*/
+{
+	elf_firmware_t	firmware;
+	avr_eeprom_desc_t	eeprom;
+	unsigned char	image[256];
+	unsigned long	*limit;
+	unsigned long	percent;
+	avr_cycle_count_t	before, end;
+	int	state, was, loop;
+	uint32_t	flags;
+	char	*equals;
+
+	if (argc < 3)
+	{
+		fprintf(stderr, "Usage: %s firmware.elf log.nmea [name=value ...]\n", argv[0]);
+		return(2);
+	}
+	for (loop = 3 ; loop < argc ; loop++)
+	{
+		equals = strchr(argv[loop], '=');
+		if (equals) *equals = 0;
+		limit = CyclesBudget(argv[loop]);
+		if (!equals || !limit)
+		{
+			fprintf(stderr, "%s: no budget or limit named %s\n", argv[0], argv[loop]);
+			return(2);
+		}
+		*limit = strtoul(equals + 1, NULL, 0);
+	}
+
+	nmea = fopen(argv[2], "rb");
+	memset(&firmware, 0, sizeof(firmware));
+	if (!nmea || elf_read_firmware(argv[1], &firmware))
+	{
+		fprintf(stderr, "%s: can't read %s or %s\n", argv[0], argv[1], argv[2]);
+		return(2);
+	}
+	strcpy(firmware.mmcu, "attiny4313");
+	firmware.frequency = F_CPU;
+	avr = avr_make_mcu_by_name(firmware.mmcu);
+	if (!avr)
+	{
+		fprintf(stderr, "%s: this simavr has no attiny4313 core\n", argv[0]);
+		return(2);
+	}
+	avr_init(avr);
+	avr_load_firmware(avr, &firmware);
+	avr->log = LOG_ERROR;						// Not every dropped UART byte
+
+	memset(image, 0xFF, sizeof(image));
+	memcpy(&image[HEADER_ADDR], eeprom_header, sizeof(eeprom_header));
+	memcpy(&image[STATUS_ADDR], eeprom_status, sizeof(eeprom_status));
+	eeprom.ee = image;
+	eeprom.offset = 0;
+	eeprom.size = sizeof(image);
+	avr_ioctl(avr, AVR_IOCTL_EEPROM_SET, &eeprom);
+
+	// Markers, interrupt flags and the PTT
+	avr_register_io_write(avr, GPIOR0_ADDR, CyclesMarker, NULL);
+	for (loop = 1 ; loop < VECTORS ; loop++)
+	{
+		avr_irq_register_notify(avr_get_interrupt_irq(avr, loop), CyclesPending,
+															(void *)(intptr_t)loop);
+	}
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), PTT_PIN),
+															CyclesKey, NULL);
+
+	// The GPS on the UART, and the reports back, kept off the console
+	flags = 0;
+	avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+	flags &= ~AVR_UART_FLAG_STDIO;
+	avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+	uart_input = avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_INPUT);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'),
+											UART_IRQ_OUTPUT), CyclesSerial, NULL);
+	avr_cycle_timer_register(avr, BYTE_CYCLES, CyclesFeed, NULL);
+
+	// Run, counting the cycles spent asleep. A wake-up lands in the same
+	// avr_run() as the sleep it ends, so the count is within a few cycles
+	// per interrupt.
+	end = (avr_cycle_count_t)*CyclesBudget("seconds") * F_CPU;
+	while ((keyups < *CyclesBudget("keyups")) && (avr->cycle < end))
+	{
+		was = avr->state;
+		before = avr->cycle;
+		state = avr_run(avr);
+		if ((state == cpu_Done) || (state == cpu_Crashed))
+		{
+			++failures;
+			printf("The firmware stopped at %.3f s\n", (double)avr->cycle / F_CPU);
+			break;
+		}
+		if ((was == cpu_Sleeping) || (avr->state == cpu_Sleeping))
+		{
+			sleep_cycles += avr->cycle - before;
+		}
+	}
+
+	// Report. An ISR that never ran is only missing if it has a budget:
+	// the budgets are measured per build, so only the ISRs it has get one.
+	printf("%-9s %10s %8s %8s %8s %9s\n", "ISR", "calls", "worst", "mean",
+														"budget", "latency");
+	for (loop = 1 ; loop < PROFILE_IDS ; loop++)
+	{
+		if (!calls[loop])
+		{
+			if (*CyclesBudget(profile_name[loop]))
+			{
+				++failures;
+				printf("%-9s never ran, budget %lu\n", profile_name[loop],
+												*CyclesBudget(profile_name[loop]));
+			}
+			continue;
+		}
+		printf("%-9s %10lu %8lu %8.1f %8lu %9lu\n", profile_name[loop], calls[loop],
+						worst[loop], (double)total[loop] / calls[loop],
+						*CyclesBudget(profile_name[loop]), latency[loop]);
+		failures += CyclesOver(profile_name[loop], worst[loop]);
+	}
+	if (rx_worst[0])
+	{
+		printf("Worst uart_rx, %lu cycles of %lu per byte, ends: %s\n",
+								worst[PROFILE_UART_RX], BYTE_CYCLES, rx_worst);
+	}
+	printf("Tone ISR latency keyed up: %lu cycles, %.1f us\n", tone_keyed,
+														tone_keyed * 1e6 / F_CPU);
+	failures += CyclesOver("tone_latency", tone_keyed);
+
+	percent = 0;
+	if (!keyups)
+	{
+		++failures;
+		printf("Never keyed up in %.0f s\n", (double)avr->cycle / F_CPU);
+	}
+	else
+	{
+		percent = (unsigned long)((keyed_cycles - keyed_sleep) * 100 / keyed_cycles);
+		printf("CPU keyed up: %lu key-ups, %.2f s, %lu%% busy\n", keyups,
+										(double)keyed_cycles / F_CPU, percent);
+		failures += CyclesOver("cpu", percent);
+		if (!tone_keyed)
+		{
+			++failures;
+			printf("The tone ISR never ran keyed up\n");
+		}
+	}
+	if (stack_report[0]) printf("%s\n", stack_report);
+
+	if (*CyclesBudget("margin") && !failures)
+	{
+		printf("BUDGETS :=");
+		for (loop = 1 ; loop < PROFILE_IDS ; loop++)
+		{
+			if (calls[loop]) printf(" %s=%lu", profile_name[loop], CyclesMargin(worst[loop]));
+		}
+		percent = CyclesMargin(percent);
+		printf(" tone_latency=%lu cpu=%lu\n", CyclesMargin(tone_keyed),
+														(percent > 100)? 100 : percent);
+	}
+
+	printf("Cycles: %s\n", failures? "FAILED" : "passed");
+	return(failures? 1 : 0);
+
+}		// End main(int argc, char **argv)
+
+
+/******************************************************************************/
+static void CyclesMarker(avr_t *avr, avr_io_addr_t address, uint8_t value,
+																void *param)
+/*******************************************************************************
+* ABSTRACT:	Called on every GPIOR0 write. An id opens a marker and takes
+*				the latency from the raise of the vector now running; a zero
+*				closes the innermost open marker and counts its cycles.
+*
+* INPUT:		avr		The core
+*				address	GPIOR0
+*				value		PROFILE_ id, or 0
+*				param		Unused
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	unsigned long	cycles;
+	unsigned char	id;
+
+	avr->data[address] = value;				// It is still a register
+
+	if (value && (value < PROFILE_IDS))
+	{
+		cycles = avr->cycle - serviced;
+		if (cycles > latency[value]) latency[value] = cycles;
+		if ((value == PROFILE_TONE) && keyed && (cycles > tone_keyed)) tone_keyed = cycles;
+		if (open_count < NESTING)
+		{
+			open_id[open_count] = value;
+			open_cycle[open_count++] = avr->cycle;
+		}
+	}
+	else if (!value && open_count)
+	{
+		id = open_id[--open_count];
+		cycles = avr->cycle - open_cycle[open_count];
+		++calls[id];
+		total[id] += cycles;
+		if (cycles > worst[id])
+		{
+			worst[id] = cycles;
+			if (id == PROFILE_UART_RX) strcpy(rx_worst, sentence);
+		}
+	}
+	return;
+
+}		// End CyclesMarker(avr_t *avr, avr_io_addr_t address, ...)
+
+
+/******************************************************************************/
+static void CyclesPending(avr_irq_t *irq, uint32_t value, void *param)
+/*******************************************************************************
+* ABSTRACT:	Called when an interrupt flag goes pending, and again when it
+*				clears as the vector is taken. Keeps when it was raised, and
+*				on the clear hands that to CyclesMarker().
+*
+* INPUT:		irq		The vector's pending IRQ
+*				value		1 raised, 0 cleared
+*				param		Vector number
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	int	vector = (int)(intptr_t)param;
+
+	if (value)
+	{
+		raised[vector] = avr->cycle;
+	}
+	else
+	{
+		serviced = raised[vector];
+	}
+	return;
+
+}		// End CyclesPending(avr_irq_t *irq, uint32_t value, void *param)
+
+
+/******************************************************************************/
+static void CyclesKey(avr_irq_t *irq, uint32_t value, void *param)
+/*******************************************************************************
+* ABSTRACT:	Called when the PTT pin changes. Times each key-up and the
+*				sleep within it.
+*
+* INPUT:		irq		The PORTB pin IRQ
+*				value		Pin level
+*				param		Unused
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	if (value && !keyed)
+	{
+		keyed = 1;
+		key_cycle = avr->cycle;
+		key_sleep = sleep_cycles;
+	}
+	else if (!value && keyed)
+	{
+		keyed = 0;
+		keyed_cycles += avr->cycle - key_cycle;
+		keyed_sleep += sleep_cycles - key_sleep;
+		++keyups;
+	}
+	return;
+
+}		// End CyclesKey(avr_irq_t *irq, uint32_t value, void *param)
+
+
+/******************************************************************************/
+static void CyclesSerial(avr_irq_t *irq, uint32_t value, void *param)
+/*******************************************************************************
+* ABSTRACT:	Called for each byte the firmware sends. Keeps the last
+*				$PTMEM stack report.
+*
+* INPUT:		irq		The UART output IRQ
+*				value		The byte
+*				param		Unused
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	if ((value == '\r') || (value == '\n'))
+	{
+		line[line_length] = 0;
+		if (!strncmp(line, "$PTMEM", 6)) strcpy(stack_report, line);
+		line_length = 0;
+	}
+	else if (line_length < sizeof(line) - 1)
+	{
+		line[line_length++] = value;
+	}
+	return;
+
+}		// End CyclesSerial(avr_irq_t *irq, uint32_t value, void *param)
+
+
+/******************************************************************************/
+static avr_cycle_count_t CyclesFeed(avr_t *avr, avr_cycle_count_t when,
+																void *param)
+/*******************************************************************************
+* ABSTRACT:	Plays the next byte of the log into the UART, one byte time
+*				after the last, starting over at the end. The firmware turns
+*				the UART off while keyed, and those bytes are lost, as they
+*				would be from a real GPS. The line so far is kept, so the
+*				receive ISR's worst case can be put down to a sentence.
+*
+* INPUT:		avr		The core
+*				when		Cycle this call was due
+*				param		Unused
+* OUTPUT:	None
+* RETURN:	Cycle the next byte is due
+*/
+{
+	int	data;
+
+	data = fgetc(nmea);
+	if (data == EOF)
+	{
+		rewind(nmea);
+		data = fgetc(nmea);
+	}
+	if ((data == '\r') || (data == '\n'))
+	{
+		sentence_length = 0;
+	}
+	else if (sentence_length < sizeof(sentence) - 1)
+	{
+		sentence[sentence_length++] = data;
+	}
+	sentence[sentence_length] = 0;
+	avr_raise_irq(uart_input, data);
+	return(when + BYTE_CYCLES);
+
+}		// End CyclesFeed(avr_t *avr, avr_cycle_count_t when, void *param)
+
+
+/******************************************************************************/
+static unsigned long *CyclesBudget(const char *name)
+/*******************************************************************************
+* ABSTRACT:	Finds a budget or limit by name.
+*
+* INPUT:		name		As given on the command line
+* OUTPUT:	None
+* RETURN:	Its value, or NULL if there is none by that name
+*/
+{
+	unsigned char	loop;
+
+	for (loop = 0 ; loop < sizeof(budget) / sizeof(budget[0]) ; loop++)
+	{
+		if (!strcmp(budget[loop].name, name)) return(&budget[loop].limit);
+	}
+
+	return(NULL);
+
+}		// End CyclesBudget(const char *name)
+
+
+/******************************************************************************/
+static unsigned char CyclesOver(const char *name, unsigned long value)
+/*******************************************************************************
+* ABSTRACT:	Checks a figure against its budget, saying so if it is over.
+*
+* INPUT:		name		Budget name
+*				value		The figure
+* OUTPUT:	None
+* RETURN:	1 if over budget, 0 if within it, there is no budget, or
+*				budgets are being measured
+*/
+{
+	unsigned long	limit;
+
+	limit = *CyclesBudget(name);
+	if (limit && (value > limit) && !*CyclesBudget("margin"))
+	{
+		printf("Over budget: %s is %lu, budget %lu\n", name, value, limit);
+		return(1);
+	}
+
+	return(0);
+
+}		// End CyclesOver(const char *name, unsigned long value)
+
+
+/******************************************************************************/
+static unsigned long CyclesMargin(unsigned long value)
+/*******************************************************************************
+* ABSTRACT:	Adds the margin to a measured figure, rounding up, for a budget.
+*
+* INPUT:		value		The figure
+* OUTPUT:	None
+* RETURN:	value plus margin percent
+*/
+{
+	return((value * (100 + *CyclesBudget("margin")) + 99) / 100);
+
+}		// End CyclesMargin(unsigned long value)
@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+"""
+File:			Memory.py
+
+				Reports how the ATtiny4313's SRAM is spent, from the linker
+				map and the listing of a build: .data, .bss and .noinit per
+				module, and the worst-case stack depth from the call graph.
+				Fails if the SRAM left over after both is below the
+				headroom.
+
+				Usage: Memory.py firmware.map firmware.lss [--ram bytes]
+														[--headroom bytes]
+
+				The stack depth is the deepest path from reset plus the
+				deepest interrupt handler, since no ISR re-enables
+				interrupts. Each function's frame is every push, rcall .+0
+				and Y pointer adjustment in its listing, so a push made
+				only around one call is counted for the whole function. A
+				call adds its return address, two bytes. Branches and jumps
+				to another label carry the frame on. Indirect calls can't be
+				followed and are listed.
+
+Functions:	main()
+				read_map(path)
+				read_listing(path)
+				stack_depth(labels, root, path)
+"""
+
+import argparse
+import re
+import sys
+
+RETURN_ADDRESS = 2							# Bytes an rcall or interrupt pushes
+
+SECTION = re.compile(r'^\s(\S+)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*)$')
+SECTION_NAME = re.compile(r'^\s(\.\S+)$')
+SECTION_REST = re.compile(r'^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*)$')
+LABEL = re.compile(r'^([0-9a-f]+) <([^>]+)>:$')
+INSTRUCTION = re.compile(r'^\s+([0-9a-f]+):\s+(?:[0-9a-f]{2} )+\s*(\S+)\s*([^;]*?)\s*(?:;\s*(?:0x([0-9a-f]+) <([^>+]+)(\+0x[0-9a-f]+)?>.*|.*))?$')
+ENDS = ('ret', 'reti', 'rjmp', 'jmp', 'ijmp')
+
+
+def read_map(path):
+	"""
+	Sums the input sections placed in .data, .bss and .noinit by module.
+
+	INPUT:		path		Linker map
+	RETURN:		{module: {'.data': bytes, '.bss': bytes, '.noinit': bytes}}
+	"""
+	modules = {}
+	output = None
+	pending = None
+	placed = False								# Past the discarded sections
+
+	with open(path, errors='replace') as lines:
+		for line in lines:
+			line = line.rstrip('\r\n')
+			if line.startswith('Linker script and memory map'):
+				placed = True
+				continue
+			if not placed:
+				continue
+			if line and not line[0].isspace():
+				name = line.split()[0]
+				output = name if name in ('.data', '.bss', '.noinit') else None
+				pending = None
+				continue
+			if output is None:
+				continue
+
+			match = SECTION.match(line)
+			if match and not match.group(1).startswith('0x'):
+				size, owner = int(match.group(3), 16), match.group(4)
+			elif SECTION_NAME.match(line):
+				pending = line					# Long name, the rest follows
+				continue
+			elif pending and SECTION_REST.match(line):
+				match = SECTION_REST.match(line)
+				size, owner = int(match.group(2), 16), match.group(3)
+			else:
+				pending = None
+				continue
+			pending = None
+
+			if size:
+				module = re.split(r'[\\/]', owner)[-1]	# Archive(member) stays
+				modules.setdefault(module, {'.data': 0, '.bss': 0, '.noinit': 0})
+				modules[module][output] += size
+
+	return modules
+
+
+def read_listing(path):
+	"""
+	Splits the listing into labels with their frame bytes and the labels
+	they call, jump to or fall through to.
+
+	INPUT:		path		avr-objdump -S or -d listing
+	RETURN:		{label: {'frame': bytes, 'calls': set, 'jumps': set,
+				'indirect': bool}}, and the vector table as a list of labels
+	"""
+	labels = {}
+	vectors = []
+	current = None
+	last = None
+	stacked = False								# Y was just loaded from SP
+
+	with open(path, errors='replace') as lines:
+		for line in lines:
+			line = line.rstrip('\r\n')
+			match = LABEL.match(line)
+			if match:
+				name = match.group(2)
+				if current and last not in ENDS and current != '__vectors':
+					labels[current]['jumps'].add(name)	# Falls through
+				current = name
+				last = None
+				labels[name] = {'frame': 0, 'calls': set(), 'jumps': set(),
+								'indirect': False}
+				continue
+
+			match = INSTRUCTION.match(line)
+			if not match or not current:
+				continue
+			mnemonic, operands, target = match.group(2), match.group(3), match.group(5)
+			entry = labels[current]
+			last = mnemonic
+			framed, stacked = stacked, (mnemonic == 'in') and ((operands == 'r28, 0x3d')
+										or (stacked and (operands == 'r29, 0x3e')))
+
+			if current == '__vectors':
+				if target:
+					vectors.append(target)
+				continue
+
+			if mnemonic == 'push':
+				entry['frame'] += 1
+			elif mnemonic == 'rcall' and operands == '.+0':
+				entry['frame'] += RETURN_ADDRESS	# Two bytes of frame at once
+			elif framed and mnemonic in ('sbiw', 'subi') and operands.startswith('r28,'):
+				entry['frame'] += int(operands.split(',')[1].strip(), 0)
+			elif mnemonic in ('icall', 'ijmp', 'eicall', 'eijmp'):
+				entry['indirect'] = True
+			elif target and (mnemonic in ('rcall', 'call')):
+				entry['calls'].add(target)
+			elif target and (target != current) and (mnemonic in ('rjmp', 'jmp')
+												or mnemonic.startswith('br')):
+				entry['jumps'].add(target)
+
+	for entry in labels.values():				# Not data or register symbols
+		entry['calls'] &= labels.keys()
+		entry['jumps'] &= labels.keys()
+	return labels, vectors
+
+
+def stack_depth(labels, root, path):
+	"""
+	Finds the deepest stack below a label: its frame, plus the deepest of
+	its callees with their return address, or of where it jumps.
+
+	INPUT:		labels		From read_listing()
+				root		Label to start from
+				path		Labels on the way here, for loops
+	RETURN:		(bytes, [labels on the deepest path]), or None for a call
+				back into the path, which is recursion
+	"""
+	entry = labels.get(root)
+	if entry is None:
+		return 0, [root]						# Outside the listing
+
+	deepest, below = 0, []
+	for target, cost in ([(t, RETURN_ADDRESS) for t in sorted(entry['calls'])]
+							+ [(t, 0) for t in sorted(entry['jumps'])]):
+		if target in path:
+			if cost:
+				return None						# Recursion: no bound
+			continue								# A loop within a function
+		result = stack_depth(labels, target, path + [target])
+		if result is None:
+			return None
+		if cost + result[0] > deepest or not below:
+			deepest, below = cost + result[0], result[1]
+
+	return entry['frame'] + deepest, [root] + below
+
+
+def main():
+	"""
+	Prints the report.
+
+	RETURN:		Exit status: 0 within the headroom, 1 over it, 2 if the files
+				can't be read
+	"""
+	parser = argparse.ArgumentParser(description='SRAM use of an ATtiny4313 build')
+	parser.add_argument('map', help='linker map, as -Wl,-Map writes it')
+	parser.add_argument('listing', help='avr-objdump -S or -d listing')
+	parser.add_argument('--ram', type=int, default=256, help='SRAM bytes')
+	parser.add_argument('--headroom', type=int, default=24,
+						help='bytes that must be left, as STACK_HEADROOM')
+	args = parser.parse_args()
+
+	try:
+		modules = read_map(args.map)
+		labels, vectors = read_listing(args.listing)
+	except OSError as error:
+		print('Memory.py: %s' % error, file=sys.stderr)
+		return 2
+	if not vectors:
+		print('Memory.py: no vector table in %s' % args.listing, file=sys.stderr)
+		return 2
+
+	print('%-28s %6s %6s %7s %6s' % ('Module', '.data', '.bss', '.noinit', 'Total'))
+	totals = {'.data': 0, '.bss': 0, '.noinit': 0}
+	for module in sorted(modules, key=lambda m: -sum(modules[m].values())):
+		sizes = modules[module]
+		print('%-28s %6d %6d %7d %6d' % (module, sizes['.data'], sizes['.bss'],
+										sizes['.noinit'], sum(sizes.values())))
+		for output in totals:
+			totals[output] += sizes[output]
+	static = sum(totals.values())
+	print('%-28s %6d %6d %7d %6d' % ('All', totals['.data'], totals['.bss'],
+										totals['.noinit'], static))
+
+	failed = False
+	reset = stack_depth(labels, vectors[0], [vectors[0]])
+	handlers = sorted(set(vectors[1:]) - {'__bad_interrupt'})
+	worst_isr = (0, [])
+	for handler in handlers:
+		result = stack_depth(labels, handler, [handler])
+		if result is None:
+			reset = None
+			break
+		if result[0] + RETURN_ADDRESS > worst_isr[0]:
+			worst_isr = (result[0] + RETURN_ADDRESS, result[1])
+	if reset is None:
+		print('Recursion: the stack has no bound')
+		return 1
+
+	print()
+	print('Stack from reset: %d bytes, %s' % (reset[0], ' > '.join(reset[1])))
+	if worst_isr[1]:
+		print('Deepest ISR:      %d bytes, %s' % (worst_isr[0], ' > '.join(worst_isr[1])))
+	indirect = sorted(name for name in labels if labels[name]['indirect'])
+	if indirect:
+		print('Indirect calls not followed, in: %s' % ', '.join(indirect))
+		failed = True
+
+	stack = reset[0] + worst_isr[0]
+	left = args.ram - static - stack
+	print('SRAM: %d static + %d stack of %d, %d left, headroom %d: %s' % (
+				static, stack, args.ram, left, args.headroom,
+				'FAILED' if failed or left < args.headroom else 'passed'))
+
+	return 1 if failed or left < args.headroom else 0
+
+
+if __name__ == '__main__':
+	sys.exit(main())
@@ -6,13 +6,14 @@ File:			Tiny_Transmitter.c
 Functions:	extern int	main(void)
 				extern void mainTransmit(void)
 				extern void mainReceive(void)
-				extern void ax25rxByte(unsigned char rxbyte)
+				extern void mainIdle(void)
+				extern void mainReport(void)
+				extern unsigned short mainStackFree(void)
+				static void mainStackPaint(void)
 				extern void mainDelay(unsigned int timeout)
 				extern void Delay(unsigned int timeout)
-				SIGNAL(SIG_OVERFLOW0)
-				SIGNAL(SIG_OVERFLOW1)
-				SIGNAL(SIG_OVERFLOW2)
-				SIGNAL(SIG_COMPARATOR)
+				ISR(TIMER0_OVF_vect)
+				ISR(TIMER0_COMPA_vect)
 
 Created:		1.00	10/05/04	GND	Gary Dion
 
@@ -39,7 +40,9 @@ Copyright:	(c)2005, Gary N. Dion (me@garydion.com). All rights reserved.
 #include <avr/eeprom.h>
 #include <avr/interrupt.h>
 #include <avr/io.h>
-#include <avr/signal.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
 
 // General purpose include files
 #include "Std_Defines.h"
@@ -49,21 +52,60 @@ Copyright:	(c)2005, Gary N. Dion (me@garydion.com). All rights reserved.
 #include "Tiny_Transmitter.h"
 #include "Message_Create.h"
 #include "GPS_Receive.h"
+#include "Analog.h"
 
-#define	RXSIZE (256)
+#ifdef DDS_TONES
+#define	DDS_COMPARE (F_CPU / 64 / DDS_RATE - 1)	// Timer0 TOP, 11 at 14.7456 MHz
+#endif
+#ifdef G3RUH
+#define	G3RUH_COMPARE (F_CPU / 8 / G3RUH_RATE - 1)	// Timer0 TOP, 47 at 14.7456 MHz
+#endif
 
-#define	WatchdogReset() asm("wdr")
+// Linker symbols bounding the free SRAM: the end of .bss and the stack top
+extern unsigned char	_end;
+extern unsigned char	__stack;
 
 // Static Functions and Variables
+static void mainStackPaint(void) __attribute__((naked, used, section(".init1")));
 volatile unsigned char delay;				// State of Delay function
 volatile unsigned char maindelay;		// State of mainDelay function
-static unsigned char msg_start;			// Index of message start after header
-static unsigned char	msg_end;				// Index of message ending character
-static unsigned char	command;				// Used just for toggling
-static unsigned char	transmit;			// Keeps track of TX/RX state
-static unsigned short crc;					// Current checksum for incoming message
-static unsigned short dcd;					// Carrier detect of sorts
-volatile char busy;							// Carrier detect of sorts
+static volatile unsigned char transmit;	// Keeps track of TX/RX state
+volatile char busy;							// Carrier detect, set by the receiver
+volatile unsigned char asleep;			// Main is in IDLE sleep, for accounting
+
+#if defined(ANALOG_SAMPLING) || defined(AFSK_RECEIVE)
+// PB1 is the comparator input (AIN1), so bit 0 keys the PTT instead:
+static char	sine[16] = {57,21,45,29,61,29,45,21,5,41,17,33,1,33,17,41};
+#else
+// This line is for if you followed the schematic:
+static char	sine[16] = {58,22,46,30,62,30,46,22,6,42,18,34,2,34,18,42};
+#endif
+// This line is for if you installed the resistors in backwards order :-) :
+//	static char	sine[16] = {30,42,54,58,62,58,54,42,34,22,10,6,2,6,10,22};
+
+#ifdef G3RUH
+#if defined(ANALOG_SAMPLING) || defined(AFSK_RECEIVE)
+#define	PTT (1<<0)
+#else
+#define	PTT (1<<1)
+#endif
+// D-to-A level 0-15 as a PORTB value with the PTT keyed. The ladder runs
+// backwards: bit 2 carries the 8s and bit 5 the 1s.
+#define	DAC(level) (PTT | (((level) & 8) >> 1) | (((level) & 4) << 1) \
+							| (((level) & 2) << 3) | (((level) & 1) << 5))
+
+// Raised cosine (alpha = 1) response to the last three scrambled bits,
+// four samples across the middle one. Row index is previous, middle, next.
+static const unsigned char g3ruh_shape[32] PROGMEM = {
+	DAC(0), DAC(0), DAC(0), DAC(0),			// 000
+	DAC(0), DAC(0), DAC(1), DAC(5),			// 001
+	DAC(10), DAC(14), DAC(14), DAC(10),		// 010
+	DAC(10), DAC(14), DAC(15), DAC(15),		// 011
+	DAC(5), DAC(1), DAC(0), DAC(0),			// 100
+	DAC(5), DAC(1), DAC(1), DAC(5),			// 101
+	DAC(15), DAC(15), DAC(14), DAC(10),		// 110
+	DAC(15), DAC(15), DAC(15), DAC(15)};	// 111
+#endif
 
 /******************************************************************************/
 extern int	main(void)
@@ -75,9 +117,11 @@ extern int	main(void)
 * RETURN:	None
 */
 {
-	static unsigned short loop;			// Generic loop variable
-	static unsigned char	ones_seconds;	// Remembers tens digit of seconds
-	static unsigned char seconds;			// Holds seconds calculated from GPS
+	unsigned char	beacons;				// Beacons since the last status text
+	unsigned char	command;				// Query heard on the air, or 0
+	unsigned long	ticks;				// ax25ticks() when the wait began
+
+	beacons = 0;
 
 	//Initialize serial communication functions
 	SerInit();
@@ -90,25 +134,35 @@ extern int	main(void)
 	//	Bit/Pin 2 (out) connected to an 8.2k ohm resistor
 	//	Bit/Pin 1 (out) connected to the PTT circuitry
 	//	Bit/Pin 0 (out) DCD LED line
+	// With ANALOG_SAMPLING, bit 0 is the PTT and ADCInit() takes bit 1 and
+	// the channel drive pins, bits 6 and 7. With AFSK_RECEIVE, bit 0 is the
+	// PTT and ax25init() takes bit 1 for the receive audio
 	PORTB = 0x00;							// Initial state is everything off
 	DDRB  = 0x3F;							// Data direction register for port B
 
-	//	Initialize the 8-bit Timer0 to clock at 1.8432 MHz
-	TCCR0A = 0x07; 							// Timer0 clock prescale of 8. This takes the place of timer 2 in Gary's original code
-
-	// Use the 16-bit Timer1 to measure frequency; set it to clock at 1.8432 MHz
-	TCCR1B = 0x02;							// Timer2 clock prescale of 8. This is still going to be timer 1. The reciever timer is not needed. 
+	//	Initialize the 8-bit Timer0 to clock at 1.8432 MHz. This takes the
+	//	place of timer 2 in Gary's original code. The clock select bits are
+	//	in TCCR0B on the ATtiny; TCCR0A only holds the waveform mode.
+	TCCR0A = 0x00;							// Timer0 in normal mode
+	TCCR0B = (1<<CS01);						// Timer0 clock prescale of 8
 
-	
 	// Enable Timer interrupts
-	TIMSK = 1<<TOIE0 | 1<<TOIE1; // 
+	TIMSK = 1<<TOIE0;
+
+	// The 16-bit Timer1 is the 1200 baud bit clock and runs from here on
+	ax25init();								// Also reads TXDELAY/TXTAIL from EEPROM
+	ADCInit();								// Telemetry sampling rides on Timer1
 
 	// Enable the watchdog timer
 	WDTCR	= (1<<WDCE) | (1<<WDE);		// Wake-up the watchdog register
 	WDTCR	= (1<<WDE) | 7;				// Enable and timeout around 2.1s
 
+	// Every interrupt source we use can wake the CPU from IDLE
+	set_sleep_mode(SLEEP_MODE_IDLE);
+
 	// Enable interrupts
 	sei();
+	MsgConfigure();							// Switch a UBX GPS to NAV-PVT
 
 	// Reset watchdog
 	WatchdogReset();
@@ -118,32 +172,42 @@ while (TRUE)
 	//		txtone = SPACE;						// Debug tone for testing (MARK or SPACE)
 	//		while(1) WatchdogReset();			// Debug with a single one tone
 	//		while(1) ax25sendByte(0);			// Debug with a toggling tone
-	Delay(250);
-	Delay(250);
-	Delay(250);
-	Delay(250);
-	Delay(250);
+	command = 0;
+	while (!command && !MsgBeaconDue())	// SmartBeaconing picks the moment
+	{
+		ticks = ax25ticks();				// Look again a quarter second on,
+		do										// by the Timer1 bit clock
+		{
+			WatchdogReset();
+			if (!Serial_Processes())		// Keep the GPS parser fed meanwhile
+			{
+				mainIdle();					// Every bit period wakes us
+			}
+			command = ax25rxCommand();	// Or a station asks for one
+		} while (!command && (ax25ticks() - ticks < BAUD_RATE / 4));
+	}
 	//		while(busy)	Delay(250);			// Wait for break (not on balloons!!!)
+	mainReport();							// Airtime, serial and stack health
 	MsgPrepare();							// Prepare variables for APRS position
 	mainTransmit();						// Enable transmitter
 
-	if (command == 0)						// Default message to be sent
+	MsgSendPos();							// Send Position Report and comment
+	ax25sendFooter();						// Queue the FCS; the ISR closes the frame
+
+	ax25sendHeader();						// Same key-up, one flag between frames
+	MsgSendTelem();						// Send Telemetry and comment
+	ax25sendFooter();
+
+	if ((++beacons >= STATUS_EVERY) || (command == 'S'))
 	{
-		MsgSendPos();						// Send Position Report and comment
+		beacons = 0;
+		ax25sendHeader();
+		ax25sendStatus();					// Send ">See garydion.com"
+		ax25sendFooter();
 	}
-	else
-	{
-		if (command == 'S')
-		{
-			ax25sendEEPROMString(48);	// Send ">See garydion.com"
-		}
 
-		if (command == 'T')
-		{
-			MsgSendTelem();				// Send Telemetry and comment
-		}
-return(1);
-	} 
+	MsgRelease();							// Let the GPS handler swap fixes again
+	ax25sendEnd();							// The ISR sends the tail and unkeys
 }
 } // End Main
 
@@ -157,21 +221,166 @@ extern void mainTransmit(void)
 * RETURN:	None
 */
 {
-	UCSRB &= ~((1<<RXCIE)|(1<<TXCIE));	// Disable the serial interrupts
+	ax25sendWait();							// Let the last tail finish first
+	SerSuspend();								// Disable the serial interrupts
+	ADCSuspend();								// The tone ISR owns PORTB now
+	ax25rxSuspend();							// Don't decode ourselves
 	ACSR &= ~(1<<ACIE);						// Disable the comparator
-	TCCR0A = 0x03; 								// Timer0 clock prescale of 64
-	TCCR1B = 0x02;								// Timer1 clock prescale of 8
+#ifdef G3RUH
+	TCCR0A = (1<<WGM01);						// Timer0 CTC at the D-to-A sample rate
+	TCCR0B = (1<<CS01);						// Timer0 clock prescale of 8
+	OCR0A = G3RUH_COMPARE;
+	TIMSK = (TIMSK & ~(1<<TOIE0)) | (1<<OCIE0A);	// Samples, not overflows
+#elif defined(DDS_TONES)
+	TCCR0A = (1<<WGM01);						// Timer0 CTC at the DDS sample rate
+	TCCR0B = (1<<CS01)|(1<<CS00);			// Timer0 clock prescale of 64
+	OCR0A = DDS_COMPARE;
+	TIMSK = (TIMSK & ~(1<<TOIE0)) | (1<<OCIE0A);	// Samples, not overflows
+#else
+	TCCR0B = (1<<CS01)|(1<<CS00);			// Timer0 clock prescale of 64
+#endif
 	transmit = TRUE;							// Enable the transmitter
 	ax25sendHeader();							// Send APRS header
 	return;
 
 }		// End mainTransmit(void)
 
+/******************************************************************************/
+extern void mainReceive(void)
+/*******************************************************************************
+* ABSTRACT:	Undo the transmit setup once the last flag is on air. Called
+*				from the AX.25 bit ISR, so keep it short.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	transmit = FALSE;							// Stop the sinewave
+	PORTB = 0x00;								// Drop PTT and the D-to-A
+#if defined(DDS_TONES) || defined(G3RUH)
+	TIMSK = (TIMSK & ~(1<<OCIE0A)) | (1<<TOIE0);	// Overflows drive Delay
+#endif
+	TCCR0A = 0x00;								// Timer0 back to normal mode...
+	TCCR0B = (1<<CS01);						// ...with the Delay prescale of 8
+	SerResume();								// Re-enable the serial interrupts
+	ADCResume();								// And the telemetry sampling
+	ax25rxResume();							// And listen again
+	return;
+
+}		// End mainReceive(void)
+
+/******************************************************************************/
+extern void mainIdle(void)
+/*******************************************************************************
+* ABSTRACT:	Put the CPU into IDLE sleep until the next interrupt. The timers
+*				and the UART keep running, so a GPS byte, a Delay timeout or
+*				the Timer1 bit clock (every 833us at most) wakes us up again.
+*				sei() lets exactly one more instruction run, so no interrupt
+*				can slip in between it and the sleep.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	cli();
+	asleep = TRUE;								// The bit ISR counts sleep time
+	sleep_enable();
+	sei();
+	sleep_cpu();								// Wake here after the ISR
+	sleep_disable();
+	asleep = FALSE;
+	return;
+
+}		// End mainIdle(void)
+
+/******************************************************************************/
+extern void mainReport(void)
+/*******************************************************************************
+* ABSTRACT:	Write the health reports to the serial port once per beacon:
+*				airtime and energy, serial losses, then the stack as
+*				"$PTMEM,bytes never used[,LOW]".
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	unsigned short	unused;
+
+	ax25report();								// Airtime, packets and duty cycle
+	SerReport();								// GPS bytes lost and ring high water
+
+	unused = mainStackFree();
+	SendString("$PTMEM,");
+	SendNumber(unused);
+	if (unused < STACK_HEADROOM)
+	{
+		SendString(",LOW");					// Too close to running into .bss
+	}
+	SendString("\r\n");
+	return;
+
+}		// End mainReport(void)
+
+/******************************************************************************/
+extern unsigned short mainStackFree(void)
+/*******************************************************************************
+* ABSTRACT:	Count the painted bytes above the end of .bss that the stack has
+*				never reached. The stack grows down, so the first byte that no
+*				longer holds STACK_CANARY marks its deepest point since reset.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	Bytes of SRAM never used by the stack
+*/
+{
+	unsigned char	*address;
+
+	address = &_end;
+	while ((address <= &__stack) && (*address == STACK_CANARY))
+	{
+		address++;
+	}
+
+	return(address - &_end);
+
+}		// End mainStackFree(void)
+
+/******************************************************************************/
+static void mainStackPaint(void)
+/*******************************************************************************
+* ABSTRACT:	Fill free SRAM with STACK_CANARY. This lives in .init1, so it
+*				runs straight out of reset before .data and .bss are set up,
+*				and falls through into the rest of the startup code. It is
+*				written in assembly because r1 is not zeroed until .init2,
+*				and compiled C may assume it already is.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	asm volatile (
+		"	ldi r30, lo8(_end)		\n"	// Z walks up from the end of .bss
+		"	ldi r31, hi8(_end)		\n"
+		"	ldi r24, %0				\n"
+		"	ldi r25, hi8(__stack + 1)	\n"
+		"1:	st Z+, r24				\n"	// Paint and step
+		"	cpi r30, lo8(__stack + 1)	\n"
+		"	cpc r31, r25			\n"
+		"	brlo 1b					\n"	// Until past the stack top
+		:: "M" (STACK_CANARY));
+
+}		// End mainStackPaint(void)
+
 /******************************************************************************/
 extern void mainDelay(unsigned char timeout)
 /*******************************************************************************
 * ABSTRACT:	This function sets "maindelay", programs the desired delay,
-*				and takes care of incoming serial characters until it's cleared.
+*				and takes care of incoming serial characters until it's cleared,
+*				sleeping whenever there are none.
 *
 * INPUT:		None
 * OUTPUT:	None
@@ -183,7 +392,10 @@ extern void mainDelay(unsigned char timeout)
 	TCNT0 = 255 - timeout;					// Set desired delay
 	while(maindelay)
 	{
-		Serial_Processes();					// Do this until cleared by interrupt
+		if (!Serial_Processes())			// Do this until cleared by interrupt
+		{
+			mainIdle();						// Nothing waiting, sleep till the next
+		}
 	}
 
 	return;
@@ -194,7 +406,8 @@ extern void mainDelay(unsigned char timeout)
 extern void Delay(unsigned char timeout)
 /*******************************************************************************
 * ABSTRACT:	This function sets "delay", programs the desired delay,
-*				and takes care of incoming serial characters until it's cleared.
+*				and takes care of incoming serial characters until it's cleared,
+*				sleeping whenever there are none.
 *
 * INPUT:		None
 * OUTPUT:	None
@@ -206,7 +419,10 @@ extern void Delay(unsigned char timeout)
 	TCNT0 = 255 - timeout;				// Set desired delay
 	while(delay)
 	{
-		Serial_Processes();				// Do this until cleared by interrupt
+		if (!Serial_Processes())		// Do this until cleared by interrupt
+		{
+			mainIdle();					// Nothing waiting, sleep till the next
+		}
 	}
 
 	return;
@@ -214,7 +430,7 @@ extern void Delay(unsigned char timeout)
 }		// End Delay(unsigned char timeout)
 
 /******************************************************************************/
-SIGNAL(SIG_OVERFLOW0)
+ISR(TIMER0_OVF_vect)
 /*******************************************************************************
 * ABSTRACT:	This function handles the counter2 overflow interrupt.
 *				Counter2 is used to generate a sine wave using resistors on
@@ -231,12 +447,10 @@ SIGNAL(SIG_OVERFLOW0)
 * RETURN:	None
 */
 {
-	// This line is for if you followed the schematic:
-	static char	sine[16] = {58,22,46,30,62,30,46,22,6,42,18,34,2,34,18,42};
-	// This line is for if you installed the resistors in backwards order :-) :
-	//	static char	sine[16] = {30,42,54,58,62,58,54,42,34,22,10,6,2,6,10,22};
 	static unsigned char sine_index;		// Index for the D-to-A sequence
 
+	ProfileEnter(PROFILE_TONE);
+
 	if (transmit)
 	{
 		++sine_index;							// Increment index
@@ -249,6 +463,63 @@ SIGNAL(SIG_OVERFLOW0)
 		delay = FALSE;							// Clear condition holding up Delay
 		TCNT0 = 0;								// Make long as possible delay
 	}
-	
 
-}		// End SIGNAL(SIG_OVERFLOW2)
\ No newline at end of file
+	ProfileExit();
+
+}		// End ISR(TIMER0_OVF_vect)
+
+
+#ifdef DDS_TONES
+/******************************************************************************/
+ISR(TIMER0_COMPA_vect)
+/*******************************************************************************
+* ABSTRACT:	This function handles the Timer0 compare interrupt, which fires at
+*				the fixed DDS_RATE while transmitting. The tuning word in txtone
+*				is added to a 16-bit phase accumulator and the top four bits
+*				pick the D-to-A value, so the tones are exact and the phase
+*				carries straight through every MARK/SPACE change.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	static unsigned short phase;			// Phase accumulator, 65536 = 1 cycle
+
+	ProfileEnter(PROFILE_TONE);
+	phase += txtone;							// Advance by the current tone
+	PORTB = sine[phase >> 12];				// Load next D-to-A sinewave value
+	ProfileExit();
+
+}		// End ISR(TIMER0_COMPA_vect)
+#endif
+
+
+#ifdef G3RUH
+/******************************************************************************/
+ISR(TIMER0_COMPA_vect)
+/*******************************************************************************
+* ABSTRACT:	This function handles the Timer0 compare interrupt, which fires at
+*				G3RUH_RATE while transmitting, four times per bit. Timer0 and
+*				Timer1 share the prescaler, so the samples hold a fixed phase
+*				against the bit clock. The last three scrambled bits are
+*				latched at the start of each group of four and pick the row
+*				of the shaping table, which puts a band-limited baseband
+*				pulse on the D-to-A.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	static unsigned char	sample;			// Sample within the bit, 0 to 3
+	static unsigned char	row;				// Table row for this bit
+
+	ProfileEnter(PROFILE_TONE);
+	if (sample == 0) row = (txtone & 7) << 2;
+	PORTB = pgm_read_byte(&g3ruh_shape[row + sample]);
+	sample = (sample + 1) & 3;
+	ProfileExit();
+
+}		// End ISR(TIMER0_COMPA_vect)
+#endif
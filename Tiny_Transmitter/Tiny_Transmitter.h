@@ -7,9 +7,61 @@ Version:		1.5
 
 *******************************************************************************/
 
+#ifndef F_CPU
+#define	F_CPU (14745600UL)					// System clock, 14.7456 MHz crystal
+#endif
+
+// Uncomment to mark interrupt entry and exit in GPIOR0. A simulator or
+// debugger watching GPIOR0 can then count the cycles spent in each ISR and
+// the latency from the timer event to the ProfileEnter() write. make
+// cycles in Target does this under simavr, against cycle budgets.
+//#define	ISR_PROFILE
+
+#define	PROFILE_TONE		(1)				// Tone ISR (Timer0)
+#define	PROFILE_BAUD		(2)				// AX.25 bit ISR (Timer1 compare)
+#define	PROFILE_UART_RX	(3)				// GPS receive ISR
+#define	PROFILE_UART_TX	(4)				// Serial transmit ISR
+#define	PROFILE_RX			(5)				// AFSK receive ISR (Timer1 capture)
+
+#ifdef ISR_PROFILE
+#define	ProfileEnter(id) (GPIOR0 = (id))
+#define	ProfileExit() (GPIOR0 = 0)
+#else
+#define	ProfileEnter(id)
+#define	ProfileExit()
+#endif
+
+// Supply current in uA for each state of the energy model reported by
+// ax25report(). Measure these on the flight hardware; the figures below are
+// the ATtiny4313 datasheet at 14.7456 MHz and 5 V plus a small FM module.
+#define	CURRENT_RUN		(7000UL)			// CPU running, transmitter off
+#define	CURRENT_IDLE	(2500UL)			// IDLE sleep between interrupts
+#define	CURRENT_TX		(90000UL)		// Keyed up, including the radio
+
+// Every beacon sends position and telemetry in one key-up. The status text
+// rides along on every STATUS_EVERY'th beacon.
+#define	STATUS_EVERY	(10)
+
+extern volatile unsigned char	asleep;	// Main is in IDLE sleep
+extern volatile char	busy;					// Receiver is hearing flags
+
+// SRAM between the end of .bss and the top of the stack is painted with
+// STACK_CANARY at reset. mainStackFree() counts how much of it the stack
+// has never touched, and mainReport() flags it when that drops below
+// STACK_HEADROOM bytes. make memory in Target checks the same figure
+// against the linker map and the worst call path.
+#define	STACK_CANARY	(0xC5)
+#define	STACK_HEADROOM	(24)
+
 // external function prototypes
 extern int	main(void);
 extern void mainTransmit(void);
+extern void mainReceive(void);
+extern void	mainIdle(void);
+extern void	mainReport(void);
+extern unsigned short	mainStackFree(void);
 extern void	mainDelay(unsigned char timeout);
 extern void	Delay(unsigned char timeout);
 
+#define	WatchdogReset() wdt_reset()		// From <avr/wdt.h>
+
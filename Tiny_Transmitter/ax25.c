@@ -4,14 +4,39 @@ File:			ax25.C
 
 				Routines for sending AX.25 Data.
 
-Functions:	extern void ax25sendHeader(void);
+Functions:	static unsigned short ax25msFlags(unsigned short ms)
+				extern void ax25init(void);
+				extern unsigned long ax25ticks(void);
+				extern void ax25report(void);
+				static unsigned short ax25permille(unsigned long part,
+												unsigned long whole);
+				extern void ax25setDestination(unsigned char *address);
+				extern void ax25sendHeader(void);
 				extern void ax25sendFooter(void);
+				extern void ax25sendEnd(void);
+				extern void ax25sendWait(void);
 				extern void ax25sendByte(char inbyte);
-				extern void ax25crcBit(int txbyte);
+				static void ax25queue(unsigned char txbyte,
+												unsigned char frame_end);
+				static void ax25idle(void);
+				extern unsigned short ax25crcByte(unsigned short crc,
+												unsigned char inbyte);
+				extern unsigned short ax25crcBuffer(unsigned short crc,
+							unsigned char *buffer, unsigned char length);
 
 				extern void ax25sendASCIIebyte(unsigned short value);
 				extern void ax25sendString(char *address);
-				extern void ax25sendEEPROMString(unsigned int address);
+				extern void ax25sendSource(unsigned char source,
+												const void *address);
+				static void ax25copySource(unsigned char source,
+									const void *address, unsigned char how);
+				extern void ax25sendStatus(void);
+				extern void ax25rxSuspend(void);
+				extern void ax25rxResume(void);
+				extern unsigned char ax25rxCommand(void);
+				static void ax25rxBit(unsigned char bit);
+				ISR(TIMER1_COMPA_vect)
+				ISR(TIMER1_CAPT_vect)
 
 Revisions:		1.00	11/03/01 JAH	Original - John Hansen / Zack Clobes
 				1.01	10/10/04	GND	Totally rewritten for AVR GNU GCC Compiler
@@ -45,7 +70,10 @@ Copyright:	(c)2005, Gary N. Dion (me@garydion.com). All rights reserved.
 
 // OS headers
 #include <avr/eeprom.h>
+#include <avr/interrupt.h>
 #include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/wdt.h>
 
 // General purpose include files
 #include "Std_Defines.h"
@@ -54,34 +82,374 @@ Copyright:	(c)2005, Gary N. Dion (me@garydion.com). All rights reserved.
 #include "ax25.h"
 #include "Tiny_Transmitter.h"
 #include "GPS_Receive.h"
+#include "Analog.h"
+#include "FX25.h"
+#include "Number.h"
 
 // Defines
-#define BIT_DELAY 189					// Delay for 0.833 ms (189 for 14.7456 MHz)
-#define TXDELAY 100						// Number of 6.7ms delay cycles (send flags)
+#define BAUD_COMPARE (F_CPU / 8 / BAUD_RATE - 1)	// Timer1 TOP, 1535 (exact)
+#define TXDELAY_MS 667					// Default preamble, 100 flags at 1200
+#define TXTAIL_MS 0						// Default flags after the closing flag
+#define HEADER_ADDR 31					// EEPROM header in use (0 for 144.39 MHz)
+#define STATUS_ADDR 48					// EEPROM ">See garydion.com" status text
+#define DEST_LEN 7						// Destination callsign and SSID bytes
+#define EE_BLOCK (8)						// EEPROM bytes fetched per read
+#define TXBUF_SIZE (32)					// Frame bytes queued ahead of the ISR
+#define TXBUF_MASK (TXBUF_SIZE - 1)		// TXBUF_SIZE must be a power of two
+#define CLOSED (2)						// txclose state once the tail flags started
+#define COPY_CRC (1)						// ax25copySource: fold bytes into crc
+#define COPY_QUEUE (2)					// ax25copySource: queue bytes for the ISR
+
+#ifdef AFSK_RECEIVE
+#define RX_BIT ((short)(F_CPU / 8 / BAUD_RATE))	// Timer1 counts per bit, and wrap
+#define RX_SPLIT ((short)(F_CPU / 8 / 3400))	// Half cycle at 1700 Hz, MARK above
+#define RX_RUN_MAX ((short)(8 * RX_BIT))	// Longer tone runs are not HDLC
+#endif
+
+#ifdef FX25
+#define FX_IDLE (0)						// Plain AX.25, or between frames
+#define FX_TAG (1)						// Sending the correlation tag
+#define FX_OPEN (2)						// Tag out, code block next
+#define FX_BLOCK (3)						// Inside the code block
+#define FX_PARITY (4)					// Sending the parity
+#endif
+
+#ifdef G3RUH
+#define ToggleLevel() (level ^= 1)		// NRZI, ahead of the scrambler
+#else
+#define ToggleLevel() (txtone = (txtone == MARK)? SPACE : MARK)
+#endif
 
 // Global variables
 static unsigned short	crc;
+static unsigned char	*destination;	// RAM destination for the next header
+static unsigned short	header_crc;		// crc after the stored header, from boot
+
+// Transmit queue between the frame builder (main) and the bit ISR
+static unsigned char	txbuf[TXBUF_SIZE];	// Frame bytes waiting to go on air
+static volatile unsigned char	txhead;	// Next free slot, advanced by main
+static volatile unsigned char	txtail;	// Next byte to send, advanced by ISR
+static volatile unsigned char	txmark[TXBUF_SIZE / 8];	// Bit set: last byte of a frame
+static volatile unsigned short	txflags;	// Flags still to be sent before data
+static volatile unsigned char	txbetween;	// Last byte out ended a frame
+static unsigned char	txskip;				// Dropping the rest of a cut frame
+static volatile unsigned char	txclose;	// No more frames, unkey after drain
+static volatile unsigned char	txactive;	// The transmitter is keyed up
+static unsigned short	delay_flags;			// Opening flags, from EEPROM at boot
+static unsigned short	tail_flags;			// Closing flags, from EEPROM at boot
+
+#ifdef AFSK_RECEIVE
+// Receive frame, filled by the capture ISR and handed over whole to main
+static unsigned char	rxbuf[RX_SIZE];	// Frame bytes, FCS included
+static volatile unsigned char	rx_length;	// Good frame waiting for main
+static volatile unsigned char	rx_enabled;	// Cleared while keyed up
+static unsigned char	rx_frame;			// Storing bytes since the last flag
+static unsigned char	rx_count;			// Bytes since the last flag
+static unsigned short	rx_crc;			// FCS register over those bytes
+static unsigned char	rx_shift;			// Data bits, lsb first
+static unsigned char	rx_bits;			// Data bits in rx_shift
+static unsigned char	rx_ones;			// Ones in a row
+#endif
+
+// Channel accounting, counted by the bit ISR in 1/BAUD_RATE s bit periods
+static volatile unsigned long	uptime_bits;	// Bit periods since boot
+static volatile unsigned long	airtime_bits;	// Bit periods spent keyed up
+static volatile unsigned long	sleep_bits;		// Bit periods spent in IDLE sleep
+static volatile unsigned short	packets;		// Frames sent since boot
+static volatile unsigned short	underruns;	// Frames cut short, queue ran dry
+
+// Static functions
+static unsigned short ax25msFlags(unsigned short ms);
+static unsigned short ax25permille(unsigned long part, unsigned long whole);
+static void ax25queue(unsigned char txbyte, unsigned char frame_end);
+static void ax25idle(void);
+static void ax25copySource(unsigned char source, const void *address,
+									unsigned char how);
+#ifdef AFSK_RECEIVE
+static void ax25rxBit(unsigned char bit);
+#endif
+
+#ifdef STRINGS_IN_FLASH
+#define HEADER_SOURCE SRC_FLASH
+#define HEADER_START ((const void *)ax25_header)
+#define STATUS_START ((const void *)ax25_status)
+
+// APAVR0 <- N4TXI-11 via WIDE2-2, UI frame, no layer 3. See the callsign
+// byte lookup table in ax25sendHeader.
+static const unsigned char ax25_header[] PROGMEM = {
+	0x82, 0xA0, 0x82, 0xAC, 0xA4, 0x60, 0x60,		// APAVR0-0
+	0x9C, 0x68, 0xA8, 0xB0, 0x92, 0x40, 0x76,		// N4TXI-11
+	0xAE, 0x92, 0x88, 0x8A, 0x64, 0x40, 0x65,		// WIDE2-2, last address
+	0x03, 0xF0, 0x00};									// Control, PID, end
+static const char ax25_status[] PROGMEM = ">See garydion.com";
+#else
+#define HEADER_SOURCE SRC_EEPROM
+#define HEADER_START ((const void *)HEADER_ADDR)
+#define STATUS_START ((const void *)STATUS_ADDR)
+#endif
+
+// Reflected CRC-CCITT (polynomial 0x8408) lookup table, kept in flash
+#if (CRC_TABLE_SIZE == 256)
+static const unsigned short crc_table[256] PROGMEM = {
+	0x0000, 0x1189, 0x2312, 0x329B, 0x4624, 0x57AD, 0x6536, 0x74BF,
+	0x8C48, 0x9DC1, 0xAF5A, 0xBED3, 0xCA6C, 0xDBE5, 0xE97E, 0xF8F7,
+	0x1081, 0x0108, 0x3393, 0x221A, 0x56A5, 0x472C, 0x75B7, 0x643E,
+	0x9CC9, 0x8D40, 0xBFDB, 0xAE52, 0xDAED, 0xCB64, 0xF9FF, 0xE876,
+	0x2102, 0x308B, 0x0210, 0x1399, 0x6726, 0x76AF, 0x4434, 0x55BD,
+	0xAD4A, 0xBCC3, 0x8E58, 0x9FD1, 0xEB6E, 0xFAE7, 0xC87C, 0xD9F5,
+	0x3183, 0x200A, 0x1291, 0x0318, 0x77A7, 0x662E, 0x54B5, 0x453C,
+	0xBDCB, 0xAC42, 0x9ED9, 0x8F50, 0xFBEF, 0xEA66, 0xD8FD, 0xC974,
+	0x4204, 0x538D, 0x6116, 0x709F, 0x0420, 0x15A9, 0x2732, 0x36BB,
+	0xCE4C, 0xDFC5, 0xED5E, 0xFCD7, 0x8868, 0x99E1, 0xAB7A, 0xBAF3,
+	0x5285, 0x430C, 0x7197, 0x601E, 0x14A1, 0x0528, 0x37B3, 0x263A,
+	0xDECD, 0xCF44, 0xFDDF, 0xEC56, 0x98E9, 0x8960, 0xBBFB, 0xAA72,
+	0x6306, 0x728F, 0x4014, 0x519D, 0x2522, 0x34AB, 0x0630, 0x17B9,
+	0xEF4E, 0xFEC7, 0xCC5C, 0xDDD5, 0xA96A, 0xB8E3, 0x8A78, 0x9BF1,
+	0x7387, 0x620E, 0x5095, 0x411C, 0x35A3, 0x242A, 0x16B1, 0x0738,
+	0xFFCF, 0xEE46, 0xDCDD, 0xCD54, 0xB9EB, 0xA862, 0x9AF9, 0x8B70,
+	0x8408, 0x9581, 0xA71A, 0xB693, 0xC22C, 0xD3A5, 0xE13E, 0xF0B7,
+	0x0840, 0x19C9, 0x2B52, 0x3ADB, 0x4E64, 0x5FED, 0x6D76, 0x7CFF,
+	0x9489, 0x8500, 0xB79B, 0xA612, 0xD2AD, 0xC324, 0xF1BF, 0xE036,
+	0x18C1, 0x0948, 0x3BD3, 0x2A5A, 0x5EE5, 0x4F6C, 0x7DF7, 0x6C7E,
+	0xA50A, 0xB483, 0x8618, 0x9791, 0xE32E, 0xF2A7, 0xC03C, 0xD1B5,
+	0x2942, 0x38CB, 0x0A50, 0x1BD9, 0x6F66, 0x7EEF, 0x4C74, 0x5DFD,
+	0xB58B, 0xA402, 0x9699, 0x8710, 0xF3AF, 0xE226, 0xD0BD, 0xC134,
+	0x39C3, 0x284A, 0x1AD1, 0x0B58, 0x7FE7, 0x6E6E, 0x5CF5, 0x4D7C,
+	0xC60C, 0xD785, 0xE51E, 0xF497, 0x8028, 0x91A1, 0xA33A, 0xB2B3,
+	0x4A44, 0x5BCD, 0x6956, 0x78DF, 0x0C60, 0x1DE9, 0x2F72, 0x3EFB,
+	0xD68D, 0xC704, 0xF59F, 0xE416, 0x90A9, 0x8120, 0xB3BB, 0xA232,
+	0x5AC5, 0x4B4C, 0x79D7, 0x685E, 0x1CE1, 0x0D68, 0x3FF3, 0x2E7A,
+	0xE70E, 0xF687, 0xC41C, 0xD595, 0xA12A, 0xB0A3, 0x8238, 0x93B1,
+	0x6B46, 0x7ACF, 0x4854, 0x59DD, 0x2D62, 0x3CEB, 0x0E70, 0x1FF9,
+	0xF78F, 0xE606, 0xD49D, 0xC514, 0xB1AB, 0xA022, 0x92B9, 0x8330,
+	0x7BC7, 0x6A4E, 0x58D5, 0x495C, 0x3DE3, 0x2C6A, 0x1EF1, 0x0F78};
+#elif (CRC_TABLE_SIZE == 16)
+static const unsigned short crc_table[16] PROGMEM = {
+	0x0000, 0x1081, 0x2102, 0x3183, 0x4204, 0x5285, 0x6306, 0x7387,
+	0x8408, 0x9489, 0xA50A, 0xB58B, 0xC60C, 0xD68D, 0xE70E, 0xF78F};
+#else
+#error "CRC_TABLE_SIZE must be 16 or 256"
+#endif
+
+/******************************************************************************/
+static unsigned short ax25msFlags(unsigned short ms)
+/*******************************************************************************
+* ABSTRACT:	This function converts milliseconds to flags (8 bit periods),
+*				rounding up. Past 54.6s at 9600 baud the count no longer fits
+*				16 bits, so it stops at 65535 flags.
+*
+* INPUT:		ms			Milliseconds, from EEPROM
+* OUTPUT:	None
+* RETURN:	Flags to send
+*/
+{
+	unsigned long	flags;
+
+	flags = ((unsigned long)ms * (BAUD_RATE / 100) + 79) / 80;
+	if (flags > 0xFFFF) flags = 0xFFFF;
+	return(flags);
+
+}		// End ax25msFlags(unsigned short ms)
+
+/******************************************************************************/
+extern void ax25init(void)
+/*******************************************************************************
+* ABSTRACT:	This function reads the preamble and tail lengths from EEPROM,
+*				converts them from milliseconds to flags (8 bit periods), and
+*				starts the Timer1 bit clock. The clock runs from boot so it
+*				also keeps time between frames. Unprogrammed EEPROM (0xFFFF)
+*				selects the defaults. The stored header never changes, so its
+*				crc is worked out here once for every frame that uses it.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	unsigned short	ms;
+
+	ms = eeprom_read_word((uint16_t *)EE_TXDELAY);
+	if (ms == 0xFFFF) ms = TXDELAY_MS;
+	delay_flags = ax25msFlags(ms);
+	if (!delay_flags) delay_flags = 1;	// The opening flag is not optional
+
+	ms = eeprom_read_word((uint16_t *)EE_TXTAIL);
+	if (ms == 0xFFFF) ms = TXTAIL_MS;
+	tail_flags = ax25msFlags(ms);
+
+	crc = CRC_INIT;
+	ax25copySource(HEADER_SOURCE, HEADER_START, COPY_CRC);
+	header_crc = crc;
+
+	// Start the baud clock: Timer1 CTC, prescale of 8, BAUD_RATE compare
+	TCCR1A = 0;
+	TCCR1B = (1<<WGM12) | (1<<CS11);
+	OCR1A = BAUD_COMPARE;
+	TCNT1 = 0;
+	TIMSK |= (1<<OCIE1A);
+
+#ifdef AFSK_RECEIVE
+	// Comparator against the bandgap into the input capture, which times
+	// the zero crossings on the same clock
+	ACSR = (1<<ACBG) | (1<<ACIC);
+	DIDR |= (1<<AIN1D);
+	DDRB &= ~(1<<1);							// Audio in on AIN1
+	TCCR1B |= (1<<ICNC1);					// Noise canceler, 4 clocks late
+	ax25rxResume();
+#endif
+	return;
+
+}		// End ax25init(void)
+
+
+/******************************************************************************/
+extern unsigned long ax25ticks(void)
+/*******************************************************************************
+* ABSTRACT:	This function returns the number of 1/BAUD_RATE s bit periods since
+*				boot, read with interrupts held off so all four bytes match.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	Bit periods since boot
+*/
+{
+	unsigned long	ticks;
+
+	cli();
+	ticks = uptime_bits;
+	sei();
+	return(ticks);
+
+}		// End ax25ticks(void)
+
+
+/******************************************************************************/
+extern void ax25report(void)
+/*******************************************************************************
+* ABSTRACT:	This function writes the channel and energy accounting to the
+*				serial port as "$PTTX,airtime ms,packets,duty cycle per mille,
+*				sleep per mille,average uA,underruns". The average current
+*				comes from the share of time spent keyed up, asleep and
+*				running, and the CURRENT_ figures in Tiny_Transmitter.h. It
+*				is also the uAh used per hour of operation.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	unsigned long	uptime;
+	unsigned long	airtime;
+	unsigned long	asleep;
+	unsigned short	count;
+	unsigned short	lost;			// Frames cut short
+	unsigned short	tx_share;		// Per mille keyed up
+	unsigned short	sleep_share;	// Per mille in IDLE sleep
+
+	cli();
+	uptime = uptime_bits;
+	airtime = airtime_bits;
+	asleep = sleep_bits;
+	count = packets;
+	lost = underruns;
+	sei();
+
+	tx_share = ax25permille(airtime, uptime);
+	sleep_share = ax25permille(asleep, uptime);
+
+	SendString("$PTTX,");
+	SendNumber(airtime * 5 / (BAUD_RATE / 200));	// Bit periods -> ms
+	SendByte(',');
+	SendNumber(count);
+	SendByte(',');
+	SendNumber(tx_share);
+	SendByte(',');
+	SendNumber(sleep_share);
+	SendByte(',');
+	SendNumber((CURRENT_TX * tx_share + CURRENT_IDLE * sleep_share
+		+ CURRENT_RUN * (1000 - tx_share - sleep_share)) / 1000);
+	SendByte(',');
+	SendNumber(lost);
+	SendString("\r\n");
+	return;
+
+}		// End ax25report(void)
+
+
+/******************************************************************************/
+static unsigned short ax25permille(unsigned long part, unsigned long whole)
+/*******************************************************************************
+* ABSTRACT:	This function returns part / whole in thousandths. Both are
+*				scaled down first, if need be, so part * 1000 fits 32 bits.
+*
+* INPUT:		part		Counter to express as a share
+*				whole		Counter it is a share of
+* OUTPUT:	None
+* RETURN:	The share, 0 to 1000
+*/
+{
+	while (part > 4000000UL)
+	{
+		part >>= 1;
+		whole >>= 1;
+	}
+
+	return(whole? (part * 1000) / whole : 0);
+
+}		// End ax25permille(unsigned long part, unsigned long whole)
+
+
+/******************************************************************************/
+extern void ax25setDestination(unsigned char *address)
+/*******************************************************************************
+* ABSTRACT:	This function replaces the EEPROM destination address in the next
+*				header with seven bytes from RAM, already shifted into AX.25
+*				form. Used by Mic-E, which carries latitude in the destination.
+*
+* INPUT:		*address	Seven destination bytes, or 0 to use the EEPROM one
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	destination = address;
+	return;
+
+}		// End ax25setDestination(unsigned char *address)
+
 
 /******************************************************************************/
 extern void ax25sendHeader(void)
 /*******************************************************************************
-* ABSTRACT:	This function keys the transmitter, sends the source and
-*				destination address, and gets ready to send the actual data.
+* ABSTRACT:	This function starts a frame: it sends the source and
+*				destination address and gets ready to send the actual data.
+*				The first frame keys the transmitter and the bit ISR, which
+*				runs on its own Timer1 compare-match baud clock, counts out
+*				the opening flags. Further frames before ax25sendEnd ride the
+*				same key-up, separated only by a shared flag. The stored
+*				header is only queued; the crc starts from header_crc. A
+*				Mic-E destination changes the bytes, so that header goes
+*				through the crc in full.
 *
 * INPUT:		None
 * OUTPUT:	None
 * RETURN:	None
 */
 {
-	static unsigned char	loop_delay;
+	unsigned char	loop;
 
-	crc = 0xFFFF;							// Initialize the crc register
+	while (txactive && txclose)			// Let an ending key-up clear the air
+	{
+		ax25idle();
+	}
 
-	// Transmit the Flag field to begin the UI-Frame
-	// Adjust length for txdelay (each one takes 6.7ms)
-	for (loop_delay = 0 ; loop_delay < TXDELAY ; loop_delay++)
+	if (!txactive)
 	{
-		(ax25sendByte(0x7E));
+		// Transmit the Flag field to begin the UI-Frame
+		// Length was set from the EEPROM TXDELAY (8 bit periods each)
+		txflags = delay_flags;
+		txbetween = TRUE;
+		txclose = FALSE;
+		txactive = TRUE;						// The bit ISR takes it from here
 	}
 
 	/* 		* * * THIS IS WHERE THE CALLSIGNS ARE DETERMINED * * *
@@ -151,8 +519,23 @@ extern void ax25sendHeader(void)
 	ax25sendByte(0xF0);						// Protocol ID - 0xF0 is no layer 3
 */
 
-//	ax25sendEEPROMString(0);				// Send the header for use on 144.39 MHz
-	ax25sendEEPROMString(31);				// Trimmed header for use in 144.34 MHz
+//	ax25sendSource(SRC_EEPROM, (const void *)0);	// Header for use on 144.39 MHz
+	if (destination)							// Destination was built in RAM
+	{
+		crc = CRC_INIT;						// Initialize the crc register
+		for (loop = 0 ; loop < DEST_LEN ; loop++)
+		{
+			ax25sendByte(destination[loop]);
+		}
+		destination = 0;						// Good for this one header only
+		ax25sendSource(HEADER_SOURCE,		// The rest of the stored header
+							(const unsigned char *)HEADER_START + DEST_LEN);
+	}
+	else
+	{
+		ax25copySource(HEADER_SOURCE, HEADER_START, COPY_QUEUE);	// Trimmed header
+		crc = header_crc;						// for 144.34 MHz, crc from boot
+	}
 	return;
 
 }		// End ax25sendHeader(void)
@@ -162,181 +545,751 @@ extern void ax25sendHeader(void)
 extern void ax25sendFooter(void)
 /*******************************************************************************
 * ABSTRACT:	This function closes out the packet with the check-sum and a
-*				final flag.
+*				final flag. It returns as soon as the bytes are queued; the
+*				bit ISR sends the closing flag after the last one, and keeps
+*				sending flags until the next frame or ax25sendEnd.
 *
 * INPUT:		None
 * OUTPUT:	None
 * RETURN:	None
 */
 {
-	static unsigned char	crchi;
+	unsigned char	crchi;
 
 	crchi = (crc >> 8)^0xFF;
-	ax25sendByte(crc^0xFF); 				// Send the low byte of the crc
-	ax25sendByte(crchi); 					// Send the high byte of the crc
-	ax25sendByte(0x7E);			  			// Send a flag to end the packet
+	ax25queue(crc^0xFF, FALSE); 			// Send the low byte of the crc
+	ax25queue(crchi, TRUE); 				// Send the high byte, then a flag
 	return;
 
 }		// End ax25sendFooter(void)
 
 
+/******************************************************************************/
+extern void ax25sendEnd(void)
+/*******************************************************************************
+* ABSTRACT:	This function ends the key-up once the frames queued so far are
+*				on air. The bit ISR sends the tail flags and unkeys.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	txclose = TRUE;
+	return;
+
+}		// End ax25sendEnd(void)
+
+
+/******************************************************************************/
+extern void ax25sendWait(void)
+/*******************************************************************************
+* ABSTRACT:	This function waits until the last key-up is off the air: the
+*				bit ISR has sent the tail and called mainReceive(). Call it
+*				before setting up the next key-up, or mainReceive() would
+*				undo that setup.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	while (txactive)
+	{
+		ax25idle();
+	}
+	return;
+
+}		// End ax25sendWait(void)
+
+
 /******************************************************************************/
 extern void ax25sendByte(unsigned char txbyte)
 /*******************************************************************************
-* ABSTRACT:	This function sends one byte by toggling the "tone" variable.
+* ABSTRACT:	This function adds one byte to the checksum and queues it for
+*				the bit ISR. Every byte queued here is frame data, so a 0x7E
+*				is bit stuffed like any other byte. Waits only if the queue
+*				is full, and a long TXDELAY keeps us here for seconds, so the
+*				wait keeps the watchdog fed.
 *
 * INPUT:		txbyte	The byte to transmit
 * OUTPUT:	None
 * RETURN:	None
 */
 {
-	static char	loop;
-	static char	bitbyte;
-	static int	bit_zero;
-	static unsigned char	sequential_ones;
+	crc = ax25crcByte(crc, txbyte);		// Fold the whole byte in at once
+	ax25queue(txbyte, FALSE);
+	return;
+
+}		// End ax25sendByte(unsigned char txbyte)
 
-	bitbyte = txbyte;							// Bitbyte will be rotated through
 
-	for (loop = 0 ; loop < 8 ; loop++)	// Loop for eight bits in the byte
+/******************************************************************************/
+static void ax25queue(unsigned char txbyte, unsigned char frame_end)
+/*******************************************************************************
+* ABSTRACT:	This function queues one byte for the bit ISR, waiting only if
+*				the queue is full. Only this function writes txmark, so the
+*				ISR can read it without a race. A long TXDELAY or several
+*				frames in one key-up keep us here for seconds, so the wait
+*				sleeps and keeps the watchdog fed.
+*
+* INPUT:		txbyte		The byte to transmit
+*				frame_end	TRUE if a flag should follow it
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	unsigned char	next;
+
+	next = (txhead + 1) & TXBUF_MASK;
+	while (next == txtail)					// Wait for the ISR to make room
 	{
-		bit_zero = bitbyte & 0x01;			// Set aside the least significant bit
+		ax25idle();
+	}
+	txbuf[txhead] = txbyte;					// Queue the byte and its mark...
+	if (frame_end)
+	{
+		txmark[txhead >> 3] |= 1 << (txhead & 7);
+	}
+	else
+	{
+		txmark[txhead >> 3] &= ~(1 << (txhead & 7));
+	}
+	txhead = next;								// ...then publish it to the ISR
+	return;
 
-		if (txbyte == 0x7E)					// Is the transmit character a flag?
-		{
-			sequential_ones = 0;				// it is immune from sequential 1's
-		}
-		else										// The transmit character is not a flag
+}		// End ax25queue(unsigned char txbyte, unsigned char frame_end)
+
+
+/******************************************************************************/
+static void ax25idle(void)
+/*******************************************************************************
+* ABSTRACT:	This function waits for the bit ISR while main has nothing to
+*				do: it kicks the watchdog and sleeps until the next interrupt,
+*				at most one bit period away.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	WatchdogReset();
+	mainIdle();
+	return;
+
+}		// End ax25idle(void)
+
+
+/******************************************************************************/
+extern unsigned short ax25crcByte(unsigned short crc, unsigned char inbyte)
+/*******************************************************************************
+* ABSTRACT:	This function folds one whole byte into the crc, least significant
+*				bit first, using the lookup table instead of eight bit steps.
+*
+* INPUT:		crc		The running crc register
+*				inbyte	The byte to add to the checksum
+* OUTPUT:	None
+* RETURN:	The updated crc register
+*/
+{
+#if (CRC_TABLE_SIZE == 256)
+	crc = (crc >> 8) ^ pgm_read_word(&crc_table[(crc ^ inbyte) & 0xFF]);
+#else
+	crc = (crc >> 4) ^ pgm_read_word(&crc_table[(crc ^ inbyte) & 0x0F]);
+	crc = (crc >> 4) ^ pgm_read_word(&crc_table[(crc ^ (inbyte >> 4)) & 0x0F]);
+#endif
+	return(crc);
+
+}		// End ax25crcByte(unsigned short crc, unsigned char inbyte)
+
+
+/******************************************************************************/
+extern unsigned short ax25crcBuffer(unsigned short crc, unsigned char *buffer,
+												unsigned char length)
+/*******************************************************************************
+* ABSTRACT:	This function runs a block of bytes through the crc. Start with
+*				CRC_INIT for a new frame, or pass a previous result to continue.
+*
+* INPUT:		crc		The running crc register
+*				*buffer	Pointer to the bytes to check
+*				length	Number of bytes in the buffer
+* OUTPUT:	None
+* RETURN:	The updated crc register
+*/
+{
+	while (length--)
+	{
+		crc = ax25crcByte(crc, *buffer++);
+	}
+
+	return(crc);
+
+}		// End ax25crcBuffer(unsigned short crc, unsigned char *buffer, ...)
+
+
+/******************************************************************************/
+extern void ax25sendASCIIebyte(unsigned short value)
+/*******************************************************************************
+* ABSTRACT:	This function sends an unsigned "extended" byte using ASCII.
+*				"Extended" means that it is 10-bits only (values up to 999.)
+*				It is always three digits with leading zeros.
+*
+* INPUT:		value		The "ebyte" to be converted into ASCII and sent.
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	NumFormat(num_buffer, (value > 999)? 999 : value, 3);
+	ax25sendString(num_buffer);
+	return;
+
+}		// End ax25sendASCIIebyte(unsigned short value)
+
+
+/******************************************************************************/
+extern void ax25sendString(char *address)
+/*******************************************************************************
+* ABSTRACT:	This function sends a null-terminated string to the packet
+*
+* INPUT:		*szString	Pointer to string to send
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	while (*address != 0)
+	{
+		ax25sendByte(*address);
+		address++;
+	}
+
+	return;
+
+}		// End ax25sendString(char *address)
+
+
+/******************************************************************************/
+extern void ax25sendSource(unsigned char source, const void *address)
+/*******************************************************************************
+* ABSTRACT:	This function sends a null-terminated string from RAM, flash or
+*				EEPROM as frame data.
+*
+* INPUT:		source	SRC_RAM, SRC_FLASH or SRC_EEPROM
+*				address	Starting address for the string in that memory
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	ax25copySource(source, address, COPY_CRC | COPY_QUEUE);
+	return;
+
+}		// End ax25sendSource(unsigned char source, const void *address)
+
+
+/******************************************************************************/
+static void ax25copySource(unsigned char source, const void *address,
+									unsigned char how)
+/*******************************************************************************
+* ABSTRACT:	This function walks a null-terminated string in RAM, flash or
+*				EEPROM, folding each byte into the crc, queueing it, or both.
+*				EEPROM is read EE_BLOCK bytes at a time, so the CPU stalls
+*				once per block rather than per byte.
+*
+* INPUT:		source	SRC_RAM, SRC_FLASH or SRC_EEPROM
+*				address	Starting address for the string in that memory
+*				how		COPY_CRC and/or COPY_QUEUE
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	const unsigned char	*from = address;
+	unsigned char	block[EE_BLOCK];		// EEPROM prefetch
+	unsigned char	index = EE_BLOCK;		// Next byte of block, empty to start
+	unsigned char	next;
+
+	while (TRUE)
+	{
+		if (source == SRC_EEPROM)
 		{
-			(ax25crcBit(bit_zero));			// So modify the checksum
+			if (index == EE_BLOCK)			// Used up, fetch the next block
+			{
+				eeprom_read_block(block, from, EE_BLOCK);
+				index = 0;
+			}
+			next = block[index++];
 		}
-
-		if (!(bit_zero))						// Is the least significant bit low?
+		else if (source == SRC_FLASH)
 		{
-			sequential_ones = 0;				// Clear the number of ones we have sent
-			txtone = (txtone == MARK)? SPACE : MARK; // Toggle transmit tone
+			next = pgm_read_byte(from);
 		}
-		else										// Else, least significant bit is high
+		else
 		{
-			if (++sequential_ones == 5)	// Is this the 5th "1" in a row?
-			{
-				mainDelay(BIT_DELAY);		// Go ahead and send it
-				txtone = (txtone == MARK)? SPACE : MARK; // Toggle transmit tone
-				sequential_ones = 0;			// Clear the number of ones we have sent
-			}
-
+			next = *from;
 		}
 
-		bitbyte >>= 1;							// Shift the reference byte one bit right
-		mainDelay(BIT_DELAY);				// Pause for the bit to be sent
+		if (next == 0) break;				// End of string
+		if (how & COPY_CRC) crc = ax25crcByte(crc, next);
+		if (how & COPY_QUEUE) ax25queue(next, FALSE);
+		from++;
 	}
 
 	return;
 
-}		// End ax25sendByte(unsigned char txbyte)
+}		// End ax25copySource(unsigned char source, const void *address, ...)
 
 
 /******************************************************************************/
-extern void ax25crcBit(int lsb_int)
+extern void ax25sendStatus(void)
 /*******************************************************************************
-* ABSTRACT:	This function takes the latest transmit bit and modifies the crc.
+* ABSTRACT:	This function sends the stored status text (">See garydion.com")
+*				from wherever STRINGS_IN_FLASH says the strings live.
 *
-* INPUT:		lsb_int	An integer with its least significant bit set of cleared
+* INPUT:		None
 * OUTPUT:	None
 * RETURN:	None
 */
 {
-	static unsigned short	xor_int;
+	ax25sendSource(HEADER_SOURCE, STATUS_START);
+	return;
 
-	xor_int = crc ^ lsb_int;				// XOR lsb of CRC with the latest bit
-	crc >>= 1;									// Shift 16-bit CRC one bit to the right
+}		// End ax25sendStatus(void)
 
-	if (xor_int & 0x0001)					// If XOR result from above has lsb set
-	{
-		crc ^= 0x8408;							// Shift 16-bit CRC one bit to the right
-	}
 
+#ifdef AFSK_RECEIVE
+/******************************************************************************/
+extern void ax25rxSuspend(void)
+/*******************************************************************************
+* ABSTRACT:	This function stops the receiver before the transmitter keys
+*				up, so our own audio is not decoded.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	TIMSK &= ~(1<<ICIE1);
+	rx_enabled = FALSE;
+	busy = FALSE;
 	return;
 
-}		// End ax25crcBit(int lsb_int)
+}		// End ax25rxSuspend(void)
 
 
 /******************************************************************************/
-extern void ax25sendASCIIebyte(unsigned short value)
+extern void ax25rxResume(void)
 /*******************************************************************************
-* ABSTRACT:	This function sends an unsigned "extended" byte using ASCII.
-*				"Extended" means that it is 10-bits only (values up to 999.)
+* ABSTRACT:	This function restarts the receiver. Any frame cut off by the
+*				transmission is dropped at the next flag.
 *
-* INPUT:		value		The "ebyte" to be converted into ASCII and sent.
+* INPUT:		None
 * OUTPUT:	None
 * RETURN:	None
 */
 {
-	static char count;
+	rx_frame = FALSE;
+	rx_enabled = TRUE;
+	TIFR = (1<<ICF1);							// Forget any edge from before
+	TIMSK |= (1<<ICIE1);
+	return;
+
+}		// End ax25rxResume(void)
 
-	if (value > 999) value = 999;
 
-	count = 0;
-	while (value >= 100)
+/******************************************************************************/
+extern unsigned char ax25rxCommand(void)
+/*******************************************************************************
+* ABSTRACT:	This function checks the frame waiting from the receiver, if
+*				any, for an APRS query and frees the buffer for the next one.
+*				"?APRS?" (all stations) and "?APRSP" ask for a position,
+*				"?APRSS" for the status text.
+*
+* INPUT:		None
+* OUTPUT:	None
+* RETURN:	'P' or 'S' for a query, 0 for nothing to do
+*/
+{
+	static const char	query[] PROGMEM = "?APRS";
+	unsigned char	index;
+	unsigned char	loop;
+	unsigned char	command;
+
+	if (!rx_length) return(0);
+
+	command = 0;
+	index = 0;
+	while ((index < rx_length) && !(rxbuf[index] & 0x01))
 	{
-		value -= 100;
-		count++;
+		index++;								// Skip to the last address byte...
 	}
-	ax25sendByte(count + 48);
+	index += 3;									// ...then the control and PID
 
-	count = 0;
-	while (value >= 10)
+	if (index + sizeof(query) <= rx_length)
 	{
-		value -= 10;
-		count++;
+		for (loop = 0 ; loop < sizeof(query) - 1 ; loop++)
+		{
+			if (rxbuf[index + loop] != pgm_read_byte(&query[loop])) break;
+		}
+		if (loop == sizeof(query) - 1)
+		{
+			command = rxbuf[index + loop];
+			if (command == '?') command = 'P';
+			if ((command != 'P') && (command != 'S')) command = 0;
+		}
+	}
+
+	rx_length = 0;								// The ISR may fill it again
+	return(command);
+
+}		// End ax25rxCommand(void)
+
+
+/******************************************************************************/
+static void ax25rxBit(unsigned char bit)
+/*******************************************************************************
+* ABSTRACT:	This function runs the HDLC deframer on one demodulated bit:
+*				flag and abort detection, stuff bit removal, byte assembly and
+*				the FCS. A flag ends the frame in progress; if it was byte
+*				aligned and its FCS checks, it is handed to main. At most one
+*				FCS byte update per call.
+*
+* INPUT:		bit			Zero or not
+* OUTPUT:	None
+* RETURN:	None
+*/
+{
+	if (bit)
+	{
+		if (++rx_ones == 7)					// Abort, or no signal
+		{
+			rx_frame = FALSE;
+			busy = FALSE;
+		}
+		if (rx_ones >= 6) return;			// A flag or worse, no data here
+	}
+	else
+	{
+		if (rx_ones == 6)						// Flag
+		{
+			// The flag's 0 and first five 1s went in as data: a byte
+			// aligned frame leaves exactly six bits in rx_shift
+			if (rx_frame && (rx_bits == 6) && (rx_count >= 17)
+				&& (rx_count <= RX_SIZE) && (rx_crc == CRC_GOOD))
+			{
+				rx_length = rx_count - 2;	// Drop the FCS
+			}
+			rx_frame = !rx_length;			// Store the next one if main is done
+			rx_count = 0;
+			rx_crc = CRC_INIT;
+			rx_bits = 0;
+			rx_ones = 0;
+			busy = TRUE;						// Someone is on the channel
+			return;
+		}
+		if (rx_ones == 5)						// Stuffed zero, not data
+		{
+			rx_ones = 0;
+			return;
+		}
+		rx_ones = 0;
+	}
+
+	rx_shift >>= 1;
+	if (bit) rx_shift |= 0x80;
+	if (++rx_bits == 8)
+	{
+		rx_bits = 0;
+		if (rx_frame)
+		{
+			if (rx_count < RX_SIZE) rxbuf[rx_count] = rx_shift;
+			if (rx_count < 255) rx_count++;
+			rx_crc = ax25crcByte(rx_crc, rx_shift);
+		}
 	}
-	ax25sendByte(count + 48);
-	ax25sendByte(value + 48);
 	return;
 
-}		// End ax25sendASCIIebyte(unsigned short value)
+}		// End ax25rxBit(unsigned char bit)
+#endif
 
 
 /******************************************************************************/
-extern void ax25sendString(char *address)
+ISR(TIMER1_COMPA_vect)
 /*******************************************************************************
-* ABSTRACT:	This function sends a null-terminated string to the packet
+* ABSTRACT:	This function handles the Timer1 compare match, once per bit at
+*				exactly BAUD_RATE. It sends the opening flags, the queued
+*				frame bytes with NRZI and bit stuffing, and a closing flag
+*				after each frame. It idles on flags until the next frame or
+*				ax25sendEnd, then sends any tail flags and unkeys. While
+*				unkeyed it counts time and steps the telemetry sampler.
+*				If the queue runs dry inside a frame, a flag closes it early
+*				(the FCS fails, so no receiver takes it), the rest of its
+*				bytes are dropped as they come, and underruns counts it.
+*				A zero bit toggles the tone, a one bit leaves it alone.
+*				With G3RUH the NRZI level is scrambled instead and shifted
+*				into txtone for the shaping filter.
+*				With FX25 each frame is preceded by the correlation tag and
+*				has its own opening flag. Its bits from there on are fed to
+*				the encoder, padded with flags to FX25_DATA bytes, and
+*				followed by the parity.
 *
-* INPUT:		*szString	Pointer to string to send
+* INPUT:		None
 * OUTPUT:	None
 * RETURN:	None
 */
 {
-	while (*address != 0)
+	static unsigned char	shift;			// Byte on air, shifted out lsb first
+	static unsigned char	bits;				// Bits of shift still to be sent
+	static unsigned char	is_flag;			// Flags are immune from stuffing
+	static unsigned char	sequential_ones;	// Ones sent since the last zero
+#ifdef G3RUH
+	static unsigned char	level;			// NRZI line level, 0 or 1
+	static unsigned long	lfsr;				// Last 17 scrambled bits
+	unsigned char	scrambled;
+#endif
+#ifdef FX25
+	static unsigned char	fx_state;		// Where we are in the FX.25 frame
+	static unsigned short	fx_count;		// Tag or parity bytes sent, or
+													// code block bits still to go
+	static unsigned char	fx_padding;		// The frame in the block is complete
+	unsigned char	bit;						// The bit going on air
+#endif
+
+	ProfileEnter(PROFILE_BAUD);
+
+	++uptime_bits;
+	if (!txactive)								// Nothing on air, just keep time
 	{
-		ax25sendByte(*address);
-		address++;
+		if (asleep) ++sleep_bits;			// Main was idling when we fired
+		ADCStep();								// And sample the telemetry
+		ProfileExit();
+		return;
 	}
+	++airtime_bits;
 
+	if (sequential_ones == 5)				// Was that the 5th "1" in a row?
+	{
+		ToggleLevel();							// Send a stuffed zero
+		sequential_ones = 0;
+#ifdef FX25
+		bit = 0;
+#endif
+	}
+	else
+	{
+		if (bits == 0)							// Time to load the next byte
+		{
+			while (txskip && (txtail != txhead))	// Drop what is left of
+			{											// a frame cut short
+				if (txmark[txtail >> 3] & (1 << (txtail & 7))) txskip = FALSE;
+				txtail = (txtail + 1) & TXBUF_MASK;
+			}
+
+#ifdef FX25
+			if (fx_state == FX_TAG)			// Correlation tag, no stuffing
+			{
+				shift = FX25Tag(fx_count);
+				is_flag = TRUE;
+				if (++fx_count == FX25_TAG) fx_state = FX_OPEN;
+			}
+			else if (fx_state == FX_OPEN)	// The code block starts with the
+			{
+				fx_state = FX_BLOCK;			// frame's own opening flag
+				fx_count = FX25_DATA * 8;
+				fx_padding = FALSE;
+				txbetween = FALSE;			// Inside the frame from here
+				FX25Reset();
+				shift = 0x7E;
+				is_flag = TRUE;
+			}
+			else if (fx_state == FX_PARITY)	// Parity, no stuffing
+			{
+				shift = FX25Parity(fx_count);
+				is_flag = TRUE;
+				if (++fx_count == FX25_CHECK) fx_state = FX_IDLE;
+			}
+			else
+#endif
+			if (txflags)						// Opening, closing or tail flags
+			{
+				--txflags;
+				shift = 0x7E;
+				is_flag = TRUE;
+			}
+#ifdef FX25
+			else if (txbetween && (fx_state == FX_BLOCK))
+			{
+				shift = 0x7E;					// Pad the block with flags
+				is_flag = TRUE;
+				fx_padding = TRUE;
+			}
+			else if (txbetween && (txtail != txhead))
+			{
+				shift = FX25Tag(0);			// A new frame, tag it first
+				is_flag = TRUE;
+				fx_state = FX_TAG;
+				fx_count = 1;
+			}
+#endif
+			else if (txtail != txhead)		// Frame data is waiting
+			{
+				shift = txbuf[txtail];
+				txbetween = txmark[txtail >> 3] & (1 << (txtail & 7));
+				if (txbetween)
+				{
+					txflags = 1;				// One flag closes this frame and
+					++packets;					// opens the next
+				}
+				txtail = (txtail + 1) & TXBUF_MASK;
+				is_flag = FALSE;
+			}
+			else if (!txbetween)			// Queue underrun mid-frame. The
+			{										// frame can't be finished, so
+				++underruns;					// close it here: its FCS fails
+				txbetween = TRUE;				// and receivers drop it. The
+				txskip = TRUE;					// rest of it is skipped as it
+				shift = 0x7E;					// is queued.
+				is_flag = TRUE;
+			}
+			else if (txclose == FALSE)		// More frames may follow, idle on
+			{
+				shift = 0x7E;					// flags until they do
+				is_flag = TRUE;
+			}
+			else if ((txclose == TRUE) && tail_flags)
+			{
+				txclose = CLOSED;
+				txflags = tail_flags - 1;	// Send the tail flags
+				shift = 0x7E;
+				is_flag = TRUE;
+			}
+			else									// Last frame and tail are out
+			{
+				txclose = FALSE;
+				txactive = FALSE;
+				mainReceive();					// Unkey and return to idle
+				ProfileExit();
+				return;
+			}
+
+			bits = 8;
+		}
+
+#ifdef FX25
+		bit = shift & 0x01;
+#endif
+		if (!(shift & 0x01))					// Is the least significant bit low?
+		{
+			sequential_ones = 0;				// Clear the number of ones we have sent
+			ToggleLevel();						// Toggle transmit tone
+		}
+		else if (!is_flag)					// Stuff only inside the frame
+		{
+			++sequential_ones;
+		}
+
+		shift >>= 1;							// Shift the reference byte one bit right
+		--bits;
+	}
+
+#ifdef FX25
+	if (fx_state == FX_BLOCK)
+	{
+		FX25Bit(bit);
+		if (--fx_count == 0)				// Code block full
+		{
+			if (fx_padding || (txbetween && is_flag && !txflags && !bits))
+			{										// Padded, or the closing flag
+				fx_state = FX_PARITY;		// just filled it exactly. Cut
+				fx_count = 0;					// any pad flag short and send
+				bits = 0;						// the parity
+			}
+			else
+			{
+				fx_state = FX_IDLE;			// Frame too long, send it plain
+			}
+		}
+	}
+#endif
+#ifdef G3RUH
+	// Self-synchronizing scrambler, 1 + x^12 + x^17
+	scrambled = (level ^ (unsigned char)(lfsr >> 11) ^ (unsigned char)(lfsr >> 16)) & 1;
+	lfsr = (lfsr << 1) | scrambled;
+	txtone = (txtone << 1) | scrambled;	// Newest bit in bit 0
+#endif
+	ProfileExit();
 	return;
 
-}		// End ax25sendString(char *address)
+}		// End ISR(TIMER1_COMPA_vect)
 
 
+#ifdef AFSK_RECEIVE
 /******************************************************************************/
-extern void ax25sendEEPROMString(unsigned int address)
+ISR(TIMER1_CAPT_vect)
 /*******************************************************************************
-* ABSTRACT:	This function sends a null-terminated string found in EEPROM
-*				at the address given
+* ABSTRACT:	This function handles the Timer1 input capture, which the
+*				comparator fires at every zero crossing of the receive audio.
+*				The time since the last crossing is a half cycle: longer than
+*				1700 Hz is MARK, shorter is SPACE. When the tone changes the
+*				run of the old tone is counted off in bit periods: NRZI makes
+*				that many bits, all ones but the last, which is a zero. The
+*				digital PLL keeps half the timing error of each change, so
+*				the bit grid follows the sender's clock without jumping on
+*				every noisy crossing. Worst case is eight bits through
+*				ax25rxBit, a few hundred cycles, well inside the 227us half
+*				cycle at 2200 Hz.
 *
-* INPUT:		address	Starting address for the string
+* INPUT:		None
 * OUTPUT:	None
 * RETURN:	None
 */
 {
-	static unsigned char temp_char;
+	static unsigned short	last;			// ICR1 at the last crossing
+	static signed short	run;				// Time in the current tone
+	static unsigned char	tone;				// TRUE for MARK
+	unsigned short	now;
+	unsigned short	half;					// This half cycle
+	unsigned char	mark;
+	unsigned char	bits;
 
-	temp_char = eeprom_read_byte ((uint8_t *)(address));
-	while (temp_char)
+	ProfileEnter(PROFILE_RX);
+
+	now = ICR1;
+	TCCR1B ^= (1<<ICES1);					// Catch the opposite edge next
+	TIFR = (1<<ICF1);							// The edge change may set the flag
+
+	half = (now >= last)? now - last : now + RX_BIT - last;	// Timer1 wraps
+	last = now;
+	mark = (half > RX_SPLIT);
+
+	if (mark == tone)
+	{
+		if (run < RX_RUN_MAX) run += half;	// Same tone, the run goes on
+		ProfileExit();
+		return;
+	}
+	tone = mark;
+
+	// The tone changed at the start of this half cycle. Round the run of
+	// the old tone to whole bits and keep the remainder as phase error.
+	run += RX_BIT / 2;
+	bits = 0;
+	while ((run >= RX_BIT) && (bits < 8))
 	{
-		ax25sendByte(temp_char);
-		temp_char = eeprom_read_byte ((uint8_t *)(++address));
+		run -= RX_BIT;
+		bits++;
+	}
+	run -= RX_BIT / 2;						// Late (+) or early (-) of the grid
+
+	if (bits && rx_enabled)				// Less than a bit is a glitch
+	{
+		while (--bits)
+		{
+			ax25rxBit(1);
+		}
+		ax25rxBit(0);
 	}
 
+	run = half + run / 2;					// Follow half the error
+	ProfileExit();
 	return;
 
-}		// End ax25sendEEPROMString(unsigned int address)
+}		// End ISR(TIMER1_CAPT_vect)
+#endif
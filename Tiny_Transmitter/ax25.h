@@ -7,18 +7,101 @@ Version:		1.5
 
 *******************************************************************************/
 
+// Uncomment to synthesize the tones with a phase accumulator at a fixed
+// sample rate (direct digital synthesis) instead of reloading Timer0.
+//#define	DDS_TONES
+
+// Uncomment for 9600 baud G3RUH FSK in place of the Bell 202 tones, for
+// radios with a 9600 data port. The scrambled bits are shaped by a table
+// and played out of the D-to-A at G3RUH_RATE; DDS_TONES does not apply.
+//#define	G3RUH
+
+#ifdef G3RUH
+#undef	DDS_TONES
+#define	G3RUH_RATE (38400UL)				// D-to-A sample rate, 4 samples per bit
+#define	BAUD_RATE (9600)						// Bit rate, and ax25ticks() per second
+#else
+#define	BAUD_RATE (1200)						// Bell 202 bit rate, and ax25ticks() per second
+#endif
+
+// Uncomment to listen between transmissions for APRS queries (?APRS?,
+// ?APRSP and ?APRSS). The receiver audio, biased to 1.1V, goes to AIN1
+// (PB1); the analog comparator against the bandgap times each zero
+// crossing with Timer1 input capture. The PTT moves to PB0, as for
+// ANALOG_SAMPLING, which needs the comparator too.
+//#define	AFSK_RECEIVE
+
+#ifdef AFSK_RECEIVE
+#ifdef G3RUH
+#error "AFSK_RECEIVE decodes 1200 baud Bell 202 only"
+#endif
+#define	RX_SIZE (40)							// Longest frame kept, with the FCS
+#endif
+
+#ifdef DDS_TONES
+#define	DDS_RATE (19200UL)					// Sample rate, exactly 16 samples per bit
+#define	MARK ((unsigned short)((1200UL * 65536UL + DDS_RATE / 2) / DDS_RATE))
+#define	SPACE ((unsigned short)((2200UL * 65536UL + DDS_RATE / 2) / DDS_RATE))
+#else
 #define	MARK (167)  						// 167 - works from 190 to 155 (1200 Hz.)
 #define	SPACE (209) 						// 213 - works from 204 to 216 (2200 Hz.)
+#endif
+
+// FCS lookup table size: 16 entries (32 bytes of flash, two lookups per byte)
+// or 256 entries (512 bytes of flash, one lookup per byte).
+#ifndef CRC_TABLE_SIZE
+#define	CRC_TABLE_SIZE (16)
+#endif
+
+#define	CRC_INIT (0xFFFF)						// FCS register value before first byte
+#define	CRC_GOOD (0xF0B8)						// FCS register after a good frame and its FCS
+
+// Where ax25sendSource() reads a null-terminated string from
+#define	SRC_RAM (0)
+#define	SRC_FLASH (1)
+#define	SRC_EEPROM (2)
+
+// Uncomment to take the AX.25 header and status text from the tables in
+// ax25.c (flash) instead of EEPROM, so one .hex image carries everything.
+// Edit the callsign in ax25_header before flying.
+//#define	STRINGS_IN_FLASH
+
+// EEPROM configuration words, in milliseconds (0xFFFF selects the default)
+#define	EE_TXDELAY (0xF0)						// Flags sent before each key-up
+#define	EE_TXTAIL (0xF2)						// Flags after the last frame
 
 // external variables
-unsigned char	txtone;						// Used in main.c SIGNAL(SIG_OVERFLOW0)
+#ifdef DDS_TONES
+unsigned short	txtone;						// Tuning word, main.c ISR(TIMER0_COMPA_vect)
+#else
+unsigned char	txtone;						// Used in main.c ISR(TIMER0_OVF_vect), or
+													// the scrambled bits with G3RUH
+#endif
 
 // external function prototypes
+extern void ax25init(void);
+extern unsigned long ax25ticks(void);
+extern void ax25report(void);
+extern void ax25setDestination(unsigned char *address);
 extern void ax25sendHeader(void);
 extern void ax25sendFooter(void);
+extern void ax25sendEnd(void);
+extern void ax25sendWait(void);
 extern void ax25sendByte(unsigned char inbyte);
-extern void ax25crcBit(int txbyte);
+extern unsigned short ax25crcByte(unsigned short crc, unsigned char inbyte);
+extern unsigned short ax25crcBuffer(unsigned short crc, unsigned char *buffer,
+											unsigned char length);
 
 extern void ax25sendASCIIebyte(unsigned short value);
 extern void ax25sendString(char *szString);
-extern void ax25sendEEPROMString(unsigned int address);
+extern void ax25sendSource(unsigned char source, const void *address);
+extern void ax25sendStatus(void);
+#ifdef AFSK_RECEIVE
+extern void ax25rxSuspend(void);
+extern void ax25rxResume(void);
+extern unsigned char ax25rxCommand(void);
+#else
+#define	ax25rxSuspend()
+#define	ax25rxResume()
+#define	ax25rxCommand() (0)
+#endif